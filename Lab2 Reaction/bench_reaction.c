@@ -0,0 +1,373 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "mydriver.h"
+
+// Замкнутый цикл измерения задержки: потоки-ответчики ждут воздействий
+// драйвера (блокирующий read или опрос с O_NONBLOCK) и сразу отвечают
+// struct rt_response с номером воздействия. Время пробуждения
+// (воздействие -> поток получил событие) считается здесь, время реакции
+// (воздействие -> ответ дошёл до драйвера) — гистограммой драйвера.
+
+static volatile int stop;
+
+struct options {
+    const char *device;
+    int threads;
+    int cpus[CPU_SETSIZE];
+    int ncpus;
+    int fifo_prio;          // 0 — обычный планировщик (CFS)
+    int busy_poll;
+    double duration;
+    const char *csv;
+    const char *baseline;
+    const char *save;
+    double threshold;       // допустимый рост перцентиля, %
+};
+
+struct sample {
+    uint64_t seq;
+    uint64_t stimulus_ns;
+    uint64_t wake_ns;
+};
+
+struct responder {
+    pthread_t thread;
+    int id;
+    const struct options *opt;
+    struct sample *samples;
+    size_t count, cap;
+    long answered, duplicate, late, errors;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void setup_thread(const struct responder *r) {
+    const struct options *opt = r->opt;
+
+    if (opt->ncpus) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(opt->cpus[r->id % opt->ncpus], &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+            fprintf(stderr, "thread %d: failed to set affinity\n", r->id);
+    }
+    if (opt->fifo_prio) {
+        struct sched_param sp = { .sched_priority = opt->fifo_prio };
+
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp))
+            fprintf(stderr, "thread %d: SCHED_FIFO needs CAP_SYS_NICE\n", r->id);
+    }
+}
+
+static void *responder_thread(void *arg) {
+    struct responder *r = arg;
+    int format = RT_FORMAT_EVENTS;
+    int flags = O_RDWR | (r->opt->busy_poll ? O_NONBLOCK : 0);
+    struct rt_response resp = { .magic = RT_RESPONSE_MAGIC };
+    struct rt_event ev;
+    int fd;
+
+    setup_thread(r);
+    fd = open(r->opt->device, flags);
+    if (fd < 0 || ioctl(fd, IOCTL_SET_FORMAT, &format) < 0) {
+        perror("responder");
+        exit(1);
+    }
+
+    while (!stop) {
+        ssize_t n = read(fd, &ev, sizeof(ev));
+        uint64_t wake = now_ns();
+
+        if (n != sizeof(ev)) {
+            // EAGAIN — обычный холостой виток опроса; EINTR — конец прогона
+            if (n < 0 && (errno == EAGAIN || errno == EINTR))
+                continue;
+            r->errors++;
+            continue;
+        }
+        // Воздействие уже вышло из истории драйвера: его времени нет, и
+        // задержка пробуждения от нуля испортила бы перцентили
+        if (!ev.stimulus_ns) {
+            r->errors++;
+            continue;
+        }
+
+        resp.seq = ev.seq;
+        if (write(fd, &resp, sizeof(resp)) == sizeof(resp))
+            r->answered++;
+        else if (errno == EALREADY)
+            r->duplicate++;     // другой поток ответил раньше
+        else if (errno == ETIME)
+            r->late++;
+        else
+            r->errors++;
+
+        if (r->count == r->cap) {
+            r->cap = r->cap ? r->cap * 2 : 4096;
+            r->samples = realloc(r->samples, r->cap * sizeof(*r->samples));
+            if (!r->samples) {
+                perror("realloc");
+                exit(1);
+            }
+        }
+        r->samples[r->count++] = (struct sample){ ev.seq, ev.stimulus_ns, wake };
+    }
+    close(fd);
+    return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Перцентили задержки пробуждения: p50, p90, p99, p99.9, max
+#define NPCT 5
+static const char *pct_names[NPCT] = { "p50", "p90", "p99", "p99.9", "max" };
+static const double pct_values[NPCT] = { 50, 90, 99, 99.9, 100 };
+
+static void percentiles(uint64_t *v, size_t n, uint64_t out[NPCT]) {
+    qsort(v, n, sizeof(*v), cmp_u64);
+    for (int i = 0; i < NPCT; i++) {
+        size_t rank = n ? (size_t)(pct_values[i] / 100 * n + 0.999999) : 0;
+        out[i] = n ? v[rank ? rank - 1 : 0] : 0;
+    }
+}
+
+static void print_table(const char *title, const uint64_t pct[NPCT], uint64_t count) {
+    printf("%-10s %10llu", title, (unsigned long long)count);
+    for (int i = 0; i < NPCT; i++)
+        printf(" %12llu", (unsigned long long)pct[i]);
+    printf("\n");
+}
+
+static int write_csv(const char *path, struct responder *rs, int threads) {
+    FILE *f = fopen(path, "w");
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fprintf(f, "thread,seq,stimulus_ns,wake_ns,wake_latency_ns\n");
+    for (int t = 0; t < threads; t++)
+        for (size_t i = 0; i < rs[t].count; i++) {
+            const struct sample *s = &rs[t].samples[i];
+            fprintf(f, "%d,%llu,%llu,%llu,%lld\n", t, (unsigned long long)s->seq,
+                    (unsigned long long)s->stimulus_ns, (unsigned long long)s->wake_ns,
+                    (long long)(s->wake_ns - s->stimulus_ns));
+        }
+    fclose(f);
+    return 0;
+}
+
+// Базовая линия: строки "<таблица> <перцентиль> <значение>"
+static int save_baseline(const char *path, const uint64_t wake[NPCT], const uint64_t react[NPCT]) {
+    FILE *f = fopen(path, "w");
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    for (int i = 0; i < NPCT; i++)
+        fprintf(f, "wake %s %llu\n", pct_names[i], (unsigned long long)wake[i]);
+    for (int i = 0; i < NPCT; i++)
+        fprintf(f, "reaction %s %llu\n", pct_names[i], (unsigned long long)react[i]);
+    fclose(f);
+    return 0;
+}
+
+// Сравнение с базовой линией; возвращает число перцентилей, выросших
+// больше порога
+static int compare_baseline(const char *path, double threshold,
+                            const uint64_t wake[NPCT], const uint64_t react[NPCT]) {
+    char table[32], name[32];
+    unsigned long long base;
+    int regressions = 0;
+    FILE *f = fopen(path, "r");
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    printf("\nbaseline %s (threshold %.1f%%)\n", path, threshold);
+    while (fscanf(f, "%31s %31s %llu", table, name, &base) == 3) {
+        const uint64_t *cur = !strcmp(table, "wake") ? wake : !strcmp(table, "reaction") ? react : NULL;
+
+        for (int i = 0; cur && i < NPCT; i++) {
+            if (strcmp(name, pct_names[i]))
+                continue;
+            double delta = base ? (double)cur[i] / base * 100 - 100 : 0;
+            int bad = delta > threshold;
+
+            printf("%-9s %-6s %12llu -> %12llu %+8.1f%%%s\n", table, name, base,
+                   (unsigned long long)cur[i], delta, bad ? "  REGRESSION" : "");
+            regressions += bad;
+        }
+    }
+    fclose(f);
+    return regressions;
+}
+
+static int parse_cpus(const char *arg, struct options *opt) {
+    char *copy = strdup(arg), *save = NULL;
+
+    for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        int lo, hi;
+
+        if (sscanf(tok, "%d-%d", &lo, &hi) != 2)
+            hi = lo = atoi(tok);
+        for (int c = lo; c <= hi && opt->ncpus < CPU_SETSIZE; c++)
+            opt->cpus[opt->ncpus++] = c;
+    }
+    free(copy);
+    return opt->ncpus ? 0 : -1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-D device] [-t threads] [-c cpus] [-f prio] [-b] [-d sec]\n"
+            "          [-o csv] [-s save_baseline] [-B baseline] [-r threshold%%]\n"
+            "  -D  устройство канала (" MYDRIVER_DEVICE_PATH ")\n"
+            "  -t  число потоков-ответчиков (1)\n"
+            "  -c  процессоры для потоков, например 2,3 или 4-7 (по кругу)\n"
+            "  -f  SCHED_FIFO с приоритетом prio вместо CFS\n"
+            "  -b  опрос с O_NONBLOCK вместо блокирующего read\n"
+            "  -d  длительность прогона в секундах (10)\n"
+            "  -o  записать все события в CSV\n"
+            "  -s  сохранить перцентили как базовую линию\n"
+            "  -B  сравнить с базовой линией, код выхода 2 при регрессии\n"
+            "  -r  допустимый рост перцентиля в процентах (10)\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    struct options opt = { .device = MYDRIVER_DEVICE_PATH, .threads = 1, .duration = 10, .threshold = 10 };
+    struct rt_hist_report hist = { .flags = RT_HIST_RESET };
+    uint64_t wake_pct[NPCT], react_pct[NPCT];
+    long answered = 0, duplicate = 0, late = 0, errors = 0;
+    size_t total = 0;
+    int c, fd;
+
+    while ((c = getopt(argc, argv, "D:t:c:f:bd:o:s:B:r:h")) != -1) {
+        switch (c) {
+        case 'D': opt.device = optarg; break;
+        case 't': opt.threads = atoi(optarg); break;
+        case 'c':
+            if (parse_cpus(optarg, &opt)) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'f': opt.fifo_prio = atoi(optarg); break;
+        case 'b': opt.busy_poll = 1; break;
+        case 'd': opt.duration = atof(optarg); break;
+        case 'o': opt.csv = optarg; break;
+        case 's': opt.save = optarg; break;
+        case 'B': opt.baseline = optarg; break;
+        case 'r': opt.threshold = atof(optarg); break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.threads < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    fd = open(opt.device, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open device");
+        return 1;
+    }
+    // Гистограмма драйвера отсчитывается от начала прогона
+    if (ioctl(fd, IOCTL_HIST_REPORT, &hist) < 0) {
+        fprintf(stderr, "ioctl failed: %s\n", strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    struct responder *rs = calloc(opt.threads, sizeof(*rs));
+    for (int i = 0; i < opt.threads; i++) {
+        rs[i].id = i;
+        rs[i].opt = &opt;
+        pthread_create(&rs[i].thread, NULL, responder_thread, &rs[i]);
+    }
+
+    usleep(opt.duration * 1e6);
+    stop = 1;
+    // Блокирующие потоки проснутся на следующем воздействии
+    for (int i = 0; i < opt.threads; i++) {
+        pthread_join(rs[i].thread, NULL);
+        answered += rs[i].answered;
+        duplicate += rs[i].duplicate;
+        late += rs[i].late;
+        errors += rs[i].errors;
+        total += rs[i].count;
+    }
+
+    hist.flags = 0;
+    if (ioctl(fd, IOCTL_HIST_REPORT, &hist) < 0) {
+        fprintf(stderr, "ioctl failed: %s\n", strerror(errno));
+        close(fd);
+        return 1;
+    }
+    close(fd);
+
+    uint64_t *wake = malloc((total ? total : 1) * sizeof(*wake));
+    size_t n = 0;
+    for (int t = 0; t < opt.threads; t++)
+        for (size_t i = 0; i < rs[t].count; i++)
+            wake[n++] = rs[t].samples[i].wake_ns - rs[t].samples[i].stimulus_ns;
+    percentiles(wake, n, wake_pct);
+    react_pct[0] = hist.p50;
+    react_pct[1] = hist.p90;
+    react_pct[2] = hist.p99;
+    react_pct[3] = hist.p999;
+    react_pct[4] = hist.max;
+
+    printf("threads %d, %s, %s, %.1f s\n", opt.threads, opt.fifo_prio ? "SCHED_FIFO" : "CFS",
+           opt.busy_poll ? "busy-poll" : "blocking", opt.duration);
+    printf("answered %ld, lost races %ld, late %ld, errors %ld\n\n", answered, duplicate, late, errors);
+    printf("%-10s %10s", "ns", "count");
+    for (int i = 0; i < NPCT; i++)
+        printf(" %12s", pct_names[i]);
+    printf("\n");
+    print_table("wake", wake_pct, n);
+    print_table("reaction", react_pct, hist.count);
+
+    int ret = 0;
+    if (opt.csv && write_csv(opt.csv, rs, opt.threads))
+        ret = 1;
+    if (opt.save && save_baseline(opt.save, wake_pct, react_pct))
+        ret = 1;
+    if (opt.baseline) {
+        int regressions = compare_baseline(opt.baseline, opt.threshold, wake_pct, react_pct);
+
+        if (regressions < 0)
+            ret = 1;
+        else if (regressions > 0)
+            ret = 2;
+    }
+
+    for (int i = 0; i < opt.threads; i++)
+        free(rs[i].samples);
+    free(rs);
+    free(wake);
+    return ret;
+}
@@ -1,43 +1,93 @@
+import sys
+
+import numpy as np
+
+# Двоичный формат драйвера, см. struct rt_export_hdr и rt_export_rec в mydriver.h
+RT_EXPORT_MAGIC = 0x31535452
+RT_EXPORT_STREAM = 0x1
+RT_EXPORT_HDR = np.dtype([('magic', '<u4'), ('version', '<u2'), ('header_size', '<u2'),
+                          ('record_size', '<u4'), ('flags', '<u4'),
+                          ('count', '<u8'), ('lost', '<u8')])
+RT_EXPORT_REC = np.dtype([('timestamp_ns', '<u8'), ('latency_ns', '<u8'),
+                          ('cpu', '<u4'), ('reserved', '<u4')])
+
+
+def read_binary_samples(filename):
+    """
+    Считывает времена реакций из двоичного отчёта драйвера (IOCTL_SET_FORMAT
+    с RT_FORMAT_BINARY или снимок IOCTL_SNAPSHOT) без разбора по строкам.
+
+    Returns:
+        Массив задержек в наносекундах или None, если файл не двоичный.
+    """
+    hdr = np.fromfile(filename, dtype=RT_EXPORT_HDR, count=1)
+    if len(hdr) == 0 or hdr['magic'][0] != RT_EXPORT_MAGIC:
+        return None
+
+    # Записи могут расти в новых версиях: берём только известный префикс
+    record_size = int(hdr['record_size'][0])
+    raw = np.fromfile(filename, dtype=np.uint8, offset=int(hdr['header_size'][0]))
+    nrecs = len(raw) // record_size
+    # В снимке (без RT_EXPORT_STREAM) число записей задано в заголовке,
+    # дальше может идти выравнивание до страницы
+    if not hdr['flags'][0] & RT_EXPORT_STREAM and hdr['count'][0]:
+        nrecs = min(nrecs, int(hdr['count'][0]))
+    raw = raw[:nrecs * record_size].reshape(-1, record_size)
+    recs = raw[:, :RT_EXPORT_REC.itemsize].copy().view(RT_EXPORT_REC).reshape(-1)
+    if hdr['lost'][0]:
+        print(f"Warning: {hdr['lost'][0]} samples were overwritten while reading.")
+    return recs['latency_ns']
+
+
 def build_text_histogram_from_file(filename):
     """
-    Считывает данные из файла, содержащего времена реакций в наносекундах,
-    и строит текстовую гистограмму.
+    Считывает данные из файла, содержащего времена реакций в наносекундах
+    (текстовый или двоичный отчёт драйвера), и строит текстовую гистограмму.
 
     Args:
         filename: Имя файла с данными.
     """
     try:
-        with open(filename, 'r') as f:
-            data = f.readlines()
+        times_ns = read_binary_samples(filename)
     except FileNotFoundError:
         print(f"Error: File '{filename}' not found.")
         return
 
-    # Преобразование строк в числа (наносекунды)
-    try:
-        times_ns = [int(line.strip().split()[0]) for line in data]
-    except ValueError:
-        print(f"Error: Invalid data format in '{filename}'. Each line should be '<number> ns'.")
+    if times_ns is None:
+        with open(filename, 'r') as f:
+            data = f.readlines()
+
+        # Преобразование строк в числа (наносекунды). Строку со сводкой
+        # ("Average: ...") из отчёта драйвера пропускаем.
+        try:
+            times_ns = [int(line.strip().split()[0]) for line in data
+                        if line.strip() and not line.startswith('Average:')]
+        except ValueError:
+            print(f"Error: Invalid data format in '{filename}'. Each line should be '<number> ns'.")
+            return
+        times_ns = np.array(times_ns, dtype=np.uint64)
+
+    if len(times_ns) == 0:
+        print(f"Error: No samples in '{filename}'.")
         return
 
     # Если все считанные значения равны нулю, то нет смысла строить гистограмму
-    if all(times == 0 for times in times_ns):
+    if not np.any(times_ns):
         print(f"Error: All values in '{filename}' are zero. Cannot build a histogram.")
         return
 
     # Определение диапазона значений и ширины столбцов
-    min_val = min(times_ns)
-    max_val = max(times_ns)
+    min_val = int(times_ns.min())
+    max_val = int(times_ns.max())
     num_bins = 10  # Количество столбцов гистограммы
-    bin_width = (max_val - min_val) / num_bins
+    if max_val == min_val:  # Все значения равны — один столбец
+        num_bins = 1
+    bin_width = (max_val - min_val) / num_bins or 1
 
-    # Подсчет количества значений в каждом столбце
-    counts = [0] * num_bins
-    for val in times_ns:
-        bin_index = int((val - min_val) / bin_width)
-        if bin_index == num_bins:  # Обработка случая, когда val == max_val
-            bin_index -= 1
-        counts[bin_index] += 1
+    # Подсчет количества значений в каждом столбце; val == max_val попадает
+    # в последний столбец
+    bin_index = ((times_ns - min_val) / bin_width).astype(np.int64)
+    counts = np.bincount(np.minimum(bin_index, num_bins - 1), minlength=num_bins)
 
     # Определение максимальной высоты столбца (для масштабирования)
     max_count = max(counts)
@@ -50,4 +100,4 @@ def build_text_histogram_from_file(filename):
         upper_bound = lower_bound + bin_width
         print(f"{lower_bound:.0f}-{upper_bound:.0f} ns: {bar} ({counts[i]})")
 
-build_text_histogram_from_file('histdata.txt')
\ No newline at end of file
+build_text_histogram_from_file(sys.argv[1] if len(sys.argv) > 1 else 'histdata.txt')
\ No newline at end of file
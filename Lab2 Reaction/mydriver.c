@@ -5,7 +5,25 @@
 #include <linux/uaccess.h>
 #include <linux/time.h>
 #include <linux/timer.h>
+#include <linux/hrtimer.h>
+#include <linux/random.h>
+#include <linux/poll.h>
+#include <linux/eventfd.h>
+#include <linux/rculist.h>
 #include <linux/device.h> 
+#include <linux/percpu.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/log2.h>
+#include <linux/workqueue.h>
+#include <linux/moduleparam.h>
+#include <linux/seq_file.h>
+#include <linux/vmalloc.h>
+#include <linux/mutex.h>
+#include <linux/math64.h>
+#include <linux/int_sqrt.h>
+
+#include "mydriver.h"
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("kolganovr & mantlern");
@@ -16,61 +34,1086 @@ MODULE_DESCRIPTION("A simple character driver for generating and measuring react
 
 static int majorNumber;
 static struct class* mydriverClass = NULL;
-static struct device* mydriverDevice = NULL;
 
-// Таймер
-static struct timer_list my_timer;
-static unsigned long interval_ms = 1000; // Интервал в миллисекундах (1 секунда по умолчанию)
+// Независимые каналы: у каждого свой минор (/dev/mydriver, /dev/mydriver1,
+// ...), таймер, интервал, хранилище и статистика. Таймер канала можно
+// привязать к процессору, чтобы мерить задержку на всех ядрах сразу.
+#define RT_MAX_CHANNELS 64
+
+static unsigned int channels = 1;
+module_param(channels, uint, 0444);
+MODULE_PARM_DESC(channels, "Number of reaction channels (minors)");
+
+static int channel_cpus[RT_MAX_CHANNELS];
+static int nr_channel_cpus;
+module_param_array(channel_cpus, int, &nr_channel_cpus, 0444);
+MODULE_PARM_DESC(channel_cpus, "CPU for each channel's timer, -1 or missing for no pinning");
+
+// Таймер воздействий. В режиме hrtimer срабатывания идут по абсолютной
+// сетке base + k * interval, поэтому период не уплывает; jitter добавляет
+// к каждому сроку случайную задержку, чтобы воздействие нельзя было
+// предугадать. Режим timer — прежний timer_list с точностью до тика.
+static u64 stim_interval_ns = NSEC_PER_SEC;    // 1 секунда по умолчанию
+
+static char *stimulus = "hrtimer";
+module_param(stimulus, charp, 0444);
+MODULE_PARM_DESC(stimulus, "Stimulus timer: hrtimer (absolute deadlines) or timer (jiffies)");
+
+static unsigned int jitter_us;
+module_param(jitter_us, uint, 0644);
+MODULE_PARM_DESC(jitter_us, "Random delay up to this many microseconds added to each stimulus");
+
+static struct rt_channel *rt_channels;
+static unsigned int rt_nr_channels;            // сколько каналов создано
+// Защищает rt_channels и rt_nr_channels от параметров модуля: их файлы
+// доступны и во время загрузки, и во время выгрузки модуля
+static DEFINE_MUTEX(rt_channels_lock);
 
-// Переменные для измерения времени реакции
-static ktime_t start_time;
-static ktime_t reaction_time;
-static unsigned long long num_reactions = 0;
-static unsigned long long sum_reaction_times = 0;
-static unsigned long long min_reaction_time = ULLONG_MAX; // Инициализируем максимальным значением
-static unsigned long long max_reaction_time = 0;
+static void rt_set_all_intervals(u64 interval_ns);
+
+// Каждое воздействие обрабатывается в прерывании (eventfd, пробуждение,
+// история), поэтому более частые воздействия могут занять процессор целиком
+#define RT_INTERVAL_MIN_NS (10 * NSEC_PER_USEC)
+
+// Общая проверка интервала для параметров модуля и атрибутов каналов
+static int interval_parse(const char *val, u64 unit, u64 *interval_ns)
+{
+    unsigned long v;
+    int ret = kstrtoul(val, 0, &v);
+
+    if (ret)
+        return ret;
+    if (v > KTIME_MAX / unit || (u64)v * unit < RT_INTERVAL_MIN_NS)
+        return -EINVAL;
+    *interval_ns = (u64)v * unit;
+    return 0;
+}
 
-#define MAX_REACTIONS 1024 // Максимальное количество хранимых реакций
-static unsigned long long reaction_times[MAX_REACTIONS]; // Массив для хранения времен реакций
-static unsigned long long current_index = 0; // Индекс для добавления новых значений в массив
+// interval_ms и interval_us задают один и тот же интервал всех каналов,
+// меняются на ходу и вступают в силу со следующего срабатывания. Интервал
+// отдельного канала меняется через его атрибут interval_us.
+static int interval_set(const char *val, u64 unit)
+{
+    u64 interval_ns;
+    int ret = interval_parse(val, unit, &interval_ns);
+
+    if (ret)
+        return ret;
+    WRITE_ONCE(stim_interval_ns, interval_ns);
+    rt_set_all_intervals(interval_ns);
+    return 0;
+}
+
+static int interval_ms_set(const char *val, const struct kernel_param *kp)
+{
+    return interval_set(val, NSEC_PER_MSEC);
+}
+
+static int interval_ms_get(char *buf, const struct kernel_param *kp)
+{
+    return sysfs_emit(buf, "%llu\n", div_u64(READ_ONCE(stim_interval_ns), NSEC_PER_MSEC));
+}
+
+static int interval_us_set(const char *val, const struct kernel_param *kp)
+{
+    return interval_set(val, NSEC_PER_USEC);
+}
+
+static int interval_us_get(char *buf, const struct kernel_param *kp)
+{
+    return sysfs_emit(buf, "%llu\n", div_u64(READ_ONCE(stim_interval_ns), NSEC_PER_USEC));
+}
+
+static const struct kernel_param_ops interval_ms_ops = {
+    .set = interval_ms_set,
+    .get = interval_ms_get,
+};
+
+static const struct kernel_param_ops interval_us_ops = {
+    .set = interval_us_set,
+    .get = interval_us_get,
+};
+
+module_param_cb(interval_ms, &interval_ms_ops, NULL, 0644);
+MODULE_PARM_DESC(interval_ms, "Stimulus interval in milliseconds");
+module_param_cb(interval_us, &interval_us_ops, NULL, 0644);
+MODULE_PARM_DESC(interval_us, "Stimulus interval in microseconds (sub-millisecond in hrtimer mode)");
+
+static bool stim_hrtimer;
+
+// Последние воздействия. Ответ ищется по номеру в этом кольце, поэтому
+// опоздавший ответ засчитывается своему воздействию, а не следующему.
+// Слот переписывает только таймер; seq в слоте 0, пока слот обновляется.
+#define RT_STIM_HISTORY 64
+
+struct rt_stim {
+    u64 seq;
+    u64 start_ns;
+    atomic64_t answered;      // номер воздействия, на которое уже ответили
+};
+
+// Зарегистрированные eventfd; списки каналов меняются под rt_evfd_lock
+struct rt_evfd {
+    struct list_head node;
+    struct eventfd_ctx *ctx;
+};
+
+static DEFINE_SPINLOCK(rt_evfd_lock);
+
+// Статистика реакций на каждом процессоре, сворачивается при чтении без
+// блокировок. Сброс только меняет поколение канала: процессор обнуляет свою
+// статистику сам при следующей записи, а читатель пропускает процессоры со
+// старым поколением, поэтому писатели по-прежнему не используют атомарные
+// операции.
+struct rt_stats {
+    unsigned int gen;         // поколение канала, к которому относятся данные
+    u64 count;
+    u64 sum;
+    u64 sum_sq;               // сумма квадратов, 128 бит: sum_sq_hi:sum_sq
+    u64 sum_sq_hi;
+    u64 min;
+    u64 max;
+    u64 duplicate;            // повторные ответы на одно воздействие
+    u64 late;                 // ответы на воздействия вне истории
+};
+
+
+// Хранилище времён реакций: кольцо на каждом процессоре. Писатель работает
+// со своим кольцом при выключенном вытеснении, поэтому запись без ожидания
+// и без атомарных операций. Кольцо состоит из блоков по RT_CHUNK_SAMPLES
+// записей; в режиме "grow" блоки выделяются по мере заполнения.
+static unsigned int samples_per_cpu = 4096;
+module_param(samples_per_cpu, uint, 0444);
+MODULE_PARM_DESC(samples_per_cpu, "Samples kept per CPU (initial size in grow mode)");
+
+static unsigned int max_samples_per_cpu = 1 << 18;
+module_param(max_samples_per_cpu, uint, 0444);
+MODULE_PARM_DESC(max_samples_per_cpu, "Per-CPU limit in grow mode, after which the oldest samples are overwritten");
+
+static char *store_mode = "overwrite";
+module_param(store_mode, charp, 0444);
+MODULE_PARM_DESC(store_mode, "Full ring policy: overwrite (oldest samples) or grow");
+
+#define RT_CHUNK_SHIFT 8
+#define RT_CHUNK_SAMPLES (1U << RT_CHUNK_SHIFT)
+#define RT_CHUNK_MASK (RT_CHUNK_SAMPLES - 1)
+
+struct rt_sample {
+    u64 timestamp_ns; // момент ответа, ktime_get
+    u64 latency_ns;
+    u32 cpu;
+    u32 reserved;
+};
+
+struct rt_cpu_store {
+    u64 head;                   // сколько записей сделано на этом процессоре
+    u64 dropped;                // не удалось выделить блок в режиме grow
+    struct rt_sample **chunks;  // rt_capacity / RT_CHUNK_SAMPLES указателей
+};
+
+static u32 rt_capacity;         // ёмкость кольца, степень двойки
+static bool rt_grow;
+
+// Гистограмма задержек на каждом процессоре, лог-линейная как в HdrHistogram:
+// значения меньше RT_HIST_SUB точные, каждая следующая степень двойки
+// делится на RT_HIST_SUB корзин. Обновляется за O(1) без блокировок.
+#define RT_HIST_SUB_BITS 5
+#define RT_HIST_SUB (1U << RT_HIST_SUB_BITS)
+#define RT_HIST_BUCKETS ((64 - RT_HIST_SUB_BITS + 1) << RT_HIST_SUB_BITS)
+
+struct rt_hist {
+    u64 counts[RT_HIST_BUCKETS];
+    u64 max;
+};
+
+static bool hist_reset_on_read;
+module_param(hist_reset_on_read, bool, 0644);
+MODULE_PARM_DESC(hist_reset_on_read, "Reset the latency histogram after each read of the percentiles attribute");
+
+struct rt_channel {
+    int id;
+    int cpu;                                // процессор таймера или -1
+
+    // Таймер воздействий
+    struct timer_list timer;
+    struct hrtimer hrtimer;
+    ktime_t stim_base;                      // срок без jitter
+    u64 interval_ns;
+    unsigned long overruns;                 // пропущенные сроки hrtimer
+
+    struct rt_stim history[RT_STIM_HISTORY];
+    u64 stim_seq;                           // номер последнего воздействия
+    u64 stim_missed;                        // вышли из истории без ответа
+
+    // Ожидающие воздействия читатели и зарегистрированные eventfd
+    wait_queue_head_t stim_wq;
+    struct list_head evfd_list;
+
+    struct rt_cpu_store __percpu *store;
+    struct work_struct grow_work;
+    struct rt_stats __percpu *stats;
+    atomic_t stats_gen;                     // меняется при сбросе статистики
+    struct rt_hist __percpu *hist;
+
+    // Сброс не трогает счётчики процессоров: запоминаем их сумму и вычитаем
+    struct mutex hist_lock;
+    u64 hist_base[RT_HIST_BUCKETS];
+    u64 hist_fold[RT_HIST_BUCKETS];
+};
 
 // Прототипы функций
 static int     dev_open(struct inode *, struct file *);
 static int     dev_release(struct inode *, struct file *);
-static ssize_t dev_read(struct file *, char *, size_t, loff_t *);
+static ssize_t dev_read(struct file *, char __user *, size_t, loff_t *);
 static ssize_t dev_write(struct file *, const char *, size_t, loff_t *);
+static __poll_t dev_poll(struct file *, poll_table *);
+static long    dev_ioctl(struct file *, unsigned int, unsigned long);
+static int     dev_mmap(struct file *, struct vm_area_struct *);
 
-// Структура file_operations определяет, как драйвер будет реагировать на операции с файлом
+// Структура file_operations определяет, как драйвер будет реагировать на операции с файлом.
+// Отчёт читается через seq_file: порциями по странице, с позицией у каждого
+// открытого файла и поддержкой lseek. В формате RT_FORMAT_EVENTS read и
+// poll вместо этого ждут воздействий.
 static struct file_operations fops =
 {
+    .owner = THIS_MODULE,
     .open = dev_open,
     .read = dev_read,
+    .llseek = seq_lseek,
     .write = dev_write,
+    .poll = dev_poll,
+    .unlocked_ioctl = dev_ioctl,
+    .mmap = dev_mmap,
     .release = dev_release,
 };
 
-// Функция, вызываемая таймером
+// Добавление блока idx, если его ещё нет. Блок может одновременно выделять
+// писатель (GFP_ATOMIC) и rt_grow_work, побеждает первый.
+static struct rt_sample *rt_chunk_alloc(struct rt_cpu_store *store, u32 idx, gfp_t gfp)
+{
+    struct rt_sample *chunk = kmalloc_array(RT_CHUNK_SAMPLES, sizeof(*chunk), gfp);
+    struct rt_sample *old;
+
+    if (!chunk)
+        return NULL;
+    old = cmpxchg_release(&store->chunks[idx], NULL, chunk);
+    if (old) {
+        kfree(chunk);
+        return old;
+    }
+    return chunk;
+}
+
+// Заранее выделяет следующие блоки, чтобы писателю не пришлось
+static void rt_grow_work_fn(struct work_struct *work)
+{
+    struct rt_channel *ch = container_of(work, struct rt_channel, grow_work);
+    u32 idx;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        struct rt_cpu_store *store = per_cpu_ptr(ch->store, cpu);
+
+        idx = ((READ_ONCE(store->head) & (rt_capacity - 1)) >> RT_CHUNK_SHIFT) + 1;
+        if (idx < rt_capacity >> RT_CHUNK_SHIFT && !READ_ONCE(store->chunks[idx]))
+            rt_chunk_alloc(store, idx, GFP_KERNEL);
+    }
+}
+
+// Запись времени реакции в кольцо текущего процессора
+static void rt_store_add(struct rt_channel *ch, u64 timestamp_ns, u64 latency_ns)
+{
+    struct rt_cpu_store *store;
+    struct rt_sample *chunk, *sample;
+    u32 slot, idx;
+    u64 head;
+
+    preempt_disable();
+    store = this_cpu_ptr(ch->store);
+    head = store->head;
+    slot = head & (rt_capacity - 1);
+    idx = slot >> RT_CHUNK_SHIFT;
+
+    chunk = smp_load_acquire(&store->chunks[idx]);
+    if (unlikely(!chunk)) {
+        chunk = rt_chunk_alloc(store, idx, GFP_ATOMIC | __GFP_NOWARN);
+        if (!chunk) {
+            store->dropped++;
+            preempt_enable();
+            return;
+        }
+    }
+
+    // На середине блока просим подготовить следующий
+    if (rt_grow && (slot & RT_CHUNK_MASK) == RT_CHUNK_SAMPLES / 2)
+        schedule_work(&ch->grow_work);
+
+    sample = &chunk[slot & RT_CHUNK_MASK];
+    sample->timestamp_ns = timestamp_ns;
+    sample->latency_ns = latency_ns;
+    sample->cpu = smp_processor_id();
+    // Запись видна читателю только вместе с новым head
+    smp_store_release(&store->head, head + 1);
+    preempt_enable();
+}
+
+static u32 rt_hist_index(u64 v)
+{
+    u32 e;
+
+    if (v < RT_HIST_SUB)
+        return v;
+    e = fls64(v) - 1;
+    return ((e - RT_HIST_SUB_BITS + 1) << RT_HIST_SUB_BITS) +
+           ((v >> (e - RT_HIST_SUB_BITS)) & (RT_HIST_SUB - 1));
+}
+
+// Середина корзины idx: ошибка не больше половины ширины корзины
+static u64 rt_hist_value(u32 idx)
+{
+    u32 e, sub;
+
+    if (idx < RT_HIST_SUB)
+        return idx;
+    e = (idx >> RT_HIST_SUB_BITS) + RT_HIST_SUB_BITS - 1;
+    sub = idx & (RT_HIST_SUB - 1);
+    return (1ULL << e) + ((u64)sub << (e - RT_HIST_SUB_BITS)) +
+           (1ULL << (e - RT_HIST_SUB_BITS) >> 1);
+}
+
+static void rt_hist_add(struct rt_channel *ch, u64 latency_ns)
+{
+    struct rt_hist *h;
+
+    preempt_disable();
+    h = this_cpu_ptr(ch->hist);
+    h->counts[rt_hist_index(latency_ns)]++;
+    if (latency_ns > h->max)
+        h->max = latency_ns;
+    preempt_enable();
+}
+
+// Перцентиль p (в десятых долях процента) по свёрнутой гистограмме
+static u64 rt_hist_percentile(const u64 *counts, u64 total, u32 p)
+{
+    u64 rank = DIV_ROUND_UP_ULL(total * p, 1000);
+    u64 seen = 0;
+    u32 i;
+
+    for (i = 0; i < RT_HIST_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank && seen)
+            return rt_hist_value(i);
+    }
+    return 0;
+}
+
+// Сворачивает гистограммы процессоров с последнего сброса в отчёт
+static void rt_hist_report(struct rt_channel *ch, struct rt_hist_report *r, bool reset)
+{
+    u64 *fold = ch->hist_fold;
+    u64 total = 0, max = 0;
+    int top = -1;
+    int cpu, i;
+
+    mutex_lock(&ch->hist_lock);
+    memset(fold, 0, sizeof(ch->hist_fold));
+    for_each_possible_cpu(cpu) {
+        struct rt_hist *h = per_cpu_ptr(ch->hist, cpu);
+
+        for (i = 0; i < RT_HIST_BUCKETS; i++)
+            fold[i] += READ_ONCE(h->counts[i]);
+        max = max_t(u64, max, READ_ONCE(h->max));
+    }
+    for (i = 0; i < RT_HIST_BUCKETS; i++) {
+        u64 cur = fold[i];
+
+        fold[i] -= ch->hist_base[i];
+        if (reset)
+            ch->hist_base[i] = cur;
+        total += fold[i];
+        if (fold[i])
+            top = i;
+    }
+
+    memset(r, 0, sizeof(*r));
+    r->count = total;
+    if (total) {
+        r->p50 = rt_hist_percentile(fold, total, 500);
+        r->p90 = rt_hist_percentile(fold, total, 900);
+        r->p99 = rt_hist_percentile(fold, total, 990);
+        r->p999 = rt_hist_percentile(fold, total, 999);
+        // Точный максимум мог остаться от прошлого окна, тогда берём
+        // верхнюю корзину окна
+        r->max = rt_hist_index(max) == top ? max : rt_hist_value(top);
+    }
+    mutex_unlock(&ch->hist_lock);
+}
+
+// Время воздействия seq, если оно ещё в истории
+static int rt_stim_start(struct rt_channel *ch, u64 seq, u64 *start_ns)
+{
+    struct rt_stim *slot = &ch->history[seq % RT_STIM_HISTORY];
+
+    if (seq == 0 || seq > smp_load_acquire(&ch->stim_seq))
+        return -EINVAL;
+    if (smp_load_acquire(&slot->seq) != seq)
+        return -ETIME;
+    *start_ns = READ_ONCE(slot->start_ns);
+    smp_rmb();
+    if (READ_ONCE(slot->seq) != seq)
+        return -ETIME;
+    return 0;
+}
+
+static void rt_stats_add(struct rt_channel *ch, u64 latency_ns, bool duplicate, bool late)
+{
+    unsigned int gen = atomic_read(&ch->stats_gen);
+    struct rt_stats *stats;
+
+    preempt_disable();
+    stats = this_cpu_ptr(ch->stats);
+    if (unlikely(stats->gen != gen)) {
+        memset(stats, 0, sizeof(*stats));
+        stats->min = U64_MAX;
+        smp_store_release(&stats->gen, gen);
+    }
+    if (duplicate) {
+        stats->duplicate++;
+    } else if (late) {
+        stats->late++;
+    } else {
+        // Квадрат задержки больше ~4.3 с не помещается в u64, такие
+        // задержки в дисперсии ограничиваются
+        u64 l = min_t(u64, latency_ns, U32_MAX);
+        u64 sq = l * l;
+
+        stats->count++;
+        stats->sum += latency_ns;
+        stats->sum_sq += sq;
+        if (stats->sum_sq < sq)
+            stats->sum_sq_hi++;
+        if (latency_ns < stats->min)
+            stats->min = latency_ns;
+        if (latency_ns > stats->max)
+            stats->max = latency_ns;
+    }
+    preempt_enable();
+}
+
+static void rt_stats_fold(struct rt_channel *ch, struct rt_stats *out)
+{
+    unsigned int gen = atomic_read(&ch->stats_gen);
+    int cpu;
+
+    memset(out, 0, sizeof(*out));
+    out->min = U64_MAX;
+    for_each_possible_cpu(cpu) {
+        struct rt_stats *stats = per_cpu_ptr(ch->stats, cpu);
+        u64 sq;
+
+        if (smp_load_acquire(&stats->gen) != gen)
+            continue;
+        out->count += READ_ONCE(stats->count);
+        out->sum += READ_ONCE(stats->sum);
+        sq = READ_ONCE(stats->sum_sq);
+        out->sum_sq += sq;
+        out->sum_sq_hi += READ_ONCE(stats->sum_sq_hi) + (out->sum_sq < sq);
+        out->min = min_t(u64, out->min, READ_ONCE(stats->min));
+        out->max = max_t(u64, out->max, READ_ONCE(stats->max));
+        out->duplicate += READ_ONCE(stats->duplicate);
+        out->late += READ_ONCE(stats->late);
+    }
+}
+
+// Дисперсия задержек в нс². Сумма квадратов 128-битная: если она не
+// помещается в u64, делим её, сдвинув вправо на shift бит (sum_sq_hi <
+// count, поэтому shift < 64). Среднее учитывается с дробной частью, иначе
+// при большом среднем и малом разбросе ошибка округления больше дисперсии.
+static u64 rt_stats_variance(const struct rt_stats *s)
+{
+    u64 n = s->count, sq = s->sum_sq, mean, mean_sq, ex2, rem;
+    u32 shift = 0;
+
+    if (n < 2)
+        return 0;
+    if (s->sum_sq_hi) {
+        shift = fls64(s->sum_sq_hi);
+        sq = (s->sum_sq_hi << (64 - shift)) | (s->sum_sq >> shift);
+    }
+    ex2 = div64_u64_rem(sq, n, &rem) << shift;
+    ex2 += mul_u64_u64_div_u64(rem, 1ULL << shift, n);
+
+    mean = div64_u64_rem(s->sum, n, &rem);
+    if (mean > U32_MAX)
+        return 0;
+    mean_sq = mean * mean + mul_u64_u64_div_u64(2 * mean, rem, n);
+    return ex2 > mean_sq ? ex2 - mean_sq : 0;
+}
+
+// Новое поколение статистики и новое окно гистограммы
+static void rt_stats_reset(struct rt_channel *ch)
+{
+    struct rt_hist_report r;
+
+    // Атомарно: одновременные сбросы из stats/reset и ioctl не должны
+    // получить одно поколение
+    atomic_inc(&ch->stats_gen);
+    rt_hist_report(ch, &r, true);
+}
+
+// Ответ на воздействие seq в момент now. Засчитывается только первый ответ
+// на воздействие; answered меняется через cmpxchg, поэтому из нескольких
+// одновременных ответов выигрывает один.
+static int rt_respond(struct rt_channel *ch, u64 now, u64 seq)
+{
+    struct rt_stim *slot = &ch->history[seq % RT_STIM_HISTORY];
+    u64 start_ns, latency_ns;
+    s64 prev;
+    int ret;
+
+    ret = rt_stim_start(ch, seq, &start_ns);
+    if (ret == -ETIME)
+        rt_stats_add(ch, 0, false, true);
+    if (ret)
+        return ret;
+
+    prev = atomic64_read(&slot->answered);
+    do {
+        if (prev == seq) {
+            rt_stats_add(ch, 0, true, false);
+            return -EALREADY;
+        }
+        if (prev > seq) {
+            rt_stats_add(ch, 0, false, true);
+            return -ETIME;
+        }
+    } while (!atomic64_try_cmpxchg(&slot->answered, &prev, seq));
+
+    latency_ns = now > start_ns ? now - start_ns : 0;
+    rt_stats_add(ch, latency_ns, false, false);
+    rt_store_add(ch, now, latency_ns);
+    rt_hist_add(ch, latency_ns);
+    return 0;
+}
+
+// Курсор читателя по кольцу одного процессора
+struct rt_cursor {
+    u64 next;
+    u64 end;
+    bool has_peek;
+    struct rt_sample peek;
+};
+
+// Итератор по всем записям, слитым по времени
+struct rt_iter {
+    struct rt_channel *ch;
+    struct rt_cursor *cursors; // nr_cpu_ids штук
+    u64 lost;                  // перезаписаны во время чтения
+};
+
+// Снимок текущего содержимого хранилища; итерация начинается сначала
+static void rt_iter_rewind(struct rt_iter *it)
+{
+    int cpu;
+
+    it->lost = 0;
+    for_each_possible_cpu(cpu) {
+        struct rt_cursor *c = &it->cursors[cpu];
+
+        c->end = smp_load_acquire(&per_cpu_ptr(it->ch->store, cpu)->head);
+        c->next = c->end > rt_capacity ? c->end - rt_capacity : 0;
+        c->has_peek = false;
+    }
+}
+
+static int rt_iter_init(struct rt_iter *it, struct rt_channel *ch)
+{
+    it->ch = ch;
+    it->cursors = kcalloc(nr_cpu_ids, sizeof(*it->cursors), GFP_KERNEL);
+    if (!it->cursors)
+        return -ENOMEM;
+    rt_iter_rewind(it);
+    return 0;
+}
+
+static void rt_iter_destroy(struct rt_iter *it)
+{
+    kfree(it->cursors);
+}
+
+// Следующая запись процессора cpu. Запись i цела, пока head - i < rt_capacity:
+// при равенстве писатель уже может переписывать её слот. Запись, которую
+// писатель успел перезаписать во время копирования, пропускается.
+static bool rt_cursor_fill(struct rt_iter *it, int cpu)
+{
+    struct rt_cpu_store *store = per_cpu_ptr(it->ch->store, cpu);
+    struct rt_cursor *c = &it->cursors[cpu];
+    struct rt_sample *chunk;
+    u64 head, oldest;
+    u32 slot;
+
+    while (!c->has_peek && c->next < c->end) {
+        head = READ_ONCE(store->head);
+        oldest = head >= rt_capacity ? head - rt_capacity + 1 : 0;
+        if (c->next < oldest) {
+            it->lost += oldest - c->next;
+            c->next = oldest;
+            continue;
+        }
+
+        slot = c->next & (rt_capacity - 1);
+        chunk = smp_load_acquire(&store->chunks[slot >> RT_CHUNK_SHIFT]);
+        c->peek = chunk[slot & RT_CHUNK_MASK];
+        smp_rmb();
+        if (READ_ONCE(store->head) - c->next >= rt_capacity) {
+            it->lost++;
+            c->next++;
+            continue;
+        }
+        c->has_peek = true;
+        c->next++;
+    }
+    return c->has_peek;
+}
+
+static bool rt_iter_next(struct rt_iter *it, struct rt_sample *out)
+{
+    int cpu, best = -1;
+
+    for_each_possible_cpu(cpu) {
+        if (!rt_cursor_fill(it, cpu))
+            continue;
+        if (best < 0 || it->cursors[cpu].peek.timestamp_ns < it->cursors[best].peek.timestamp_ns)
+            best = cpu;
+    }
+    if (best < 0)
+        return false;
+
+    *out = it->cursors[best].peek;
+    it->cursors[best].has_peek = false;
+    return true;
+}
+
+static void rt_channel_free(struct rt_channel *ch)
+{
+    u32 i;
+    int cpu;
+
+    free_percpu(ch->hist);
+    ch->hist = NULL;
+    free_percpu(ch->stats);
+    ch->stats = NULL;
+    if (!ch->store)
+        return;
+    cancel_work_sync(&ch->grow_work);
+    for_each_possible_cpu(cpu) {
+        struct rt_cpu_store *store = per_cpu_ptr(ch->store, cpu);
+
+        if (!store->chunks)
+            continue;
+        for (i = 0; i < rt_capacity >> RT_CHUNK_SHIFT; i++)
+            kfree(store->chunks[i]);
+        kvfree(store->chunks);
+    }
+    free_percpu(ch->store);
+    ch->store = NULL;
+}
+
+// Проверка параметров хранилища, общих для всех каналов
+static int rt_store_config(void)
+{
+    if (!strcmp(store_mode, "grow")) {
+        rt_grow = true;
+    } else if (strcmp(store_mode, "overwrite")) {
+        printk(KERN_ALERT "mydriver: unknown store_mode %s\n", store_mode);
+        return -EINVAL;
+    }
+    if (samples_per_cpu == 0 || (rt_grow && max_samples_per_cpu < samples_per_cpu)) {
+        printk(KERN_ALERT "mydriver: invalid samples_per_cpu/max_samples_per_cpu\n");
+        return -EINVAL;
+    }
+
+    rt_capacity = roundup_pow_of_two(max_t(u32, rt_grow ? max_samples_per_cpu : samples_per_cpu,
+                                           RT_CHUNK_SAMPLES));
+    return 0;
+}
+
+// Канал с пустой статистикой. В режиме overwrite все блоки хранилища
+// выделяются сразу, в режиме grow — только первые samples_per_cpu записей,
+// остальные до max_samples_per_cpu по мере записи.
+static int rt_channel_init(struct rt_channel *ch, int id)
+{
+    u32 nchunks = rt_capacity >> RT_CHUNK_SHIFT;
+    u32 prealloc = rt_grow ? DIV_ROUND_UP(samples_per_cpu, RT_CHUNK_SAMPLES) : nchunks;
+    u32 i;
+    int cpu;
+
+    ch->id = id;
+    ch->cpu = id < nr_channel_cpus ? channel_cpus[id] : -1;
+    if (ch->cpu >= 0 && (ch->cpu >= nr_cpu_ids || !cpu_online(ch->cpu))) {
+        printk(KERN_ALERT "mydriver: channel %d: CPU %d is not online\n", id, ch->cpu);
+        return -EINVAL;
+    }
+    ch->interval_ns = READ_ONCE(stim_interval_ns);
+    init_waitqueue_head(&ch->stim_wq);
+    INIT_LIST_HEAD(&ch->evfd_list);
+    mutex_init(&ch->hist_lock);
+    atomic_set(&ch->stats_gen, 0);
+    INIT_WORK(&ch->grow_work, rt_grow_work_fn);
+
+    ch->store = alloc_percpu(struct rt_cpu_store);
+    ch->hist = alloc_percpu(struct rt_hist);
+    ch->stats = alloc_percpu(struct rt_stats);
+    if (!ch->store || !ch->hist || !ch->stats)
+        goto err;
+
+    for_each_possible_cpu(cpu) {
+        struct rt_cpu_store *store = per_cpu_ptr(ch->store, cpu);
+
+        per_cpu_ptr(ch->stats, cpu)->min = U64_MAX;
+
+        store->chunks = kvcalloc(nchunks, sizeof(*store->chunks), GFP_KERNEL);
+        if (!store->chunks)
+            goto err;
+        for (i = 0; i < prealloc; i++) {
+            if (!rt_chunk_alloc(store, i, GFP_KERNEL))
+                goto err;
+        }
+    }
+    return 0;
+
+err:
+    rt_channel_free(ch);
+    return -ENOMEM;
+}
+
+// Атрибуты канала: /sys/class/mydriver_class/mydriver*/
+
+// Перцентили задержек
+static ssize_t percentiles_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct rt_channel *ch = dev_get_drvdata(dev);
+    struct rt_hist_report r;
+
+    rt_hist_report(ch, &r, hist_reset_on_read);
+    return sysfs_emit(buf, "count: %llu\np50: %llu ns\np90: %llu ns\np99: %llu ns\np99.9: %llu ns\nmax: %llu ns\n",
+                      r.count, r.p50, r.p90, r.p99, r.p999, r.max);
+}
+static DEVICE_ATTR_RO(percentiles);
+
+// Интервал воздействий канала, со следующего срабатывания
+static ssize_t interval_us_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct rt_channel *ch = dev_get_drvdata(dev);
+
+    return sysfs_emit(buf, "%llu\n", div_u64(READ_ONCE(ch->interval_ns), NSEC_PER_USEC));
+}
+
+static ssize_t interval_us_store(struct device *dev, struct device_attribute *attr,
+                                 const char *buf, size_t count)
+{
+    struct rt_channel *ch = dev_get_drvdata(dev);
+    u64 interval_ns;
+    int ret = interval_parse(buf, NSEC_PER_USEC, &interval_ns);
+
+    if (ret)
+        return ret;
+    WRITE_ONCE(ch->interval_ns, interval_ns);
+    return count;
+}
+static DEVICE_ATTR_RW(interval_us);
+
+static ssize_t cpu_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct rt_channel *ch = dev_get_drvdata(dev);
+
+    return sysfs_emit(buf, "%d\n", ch->cpu);
+}
+static DEVICE_ATTR_RO(cpu);
+
+// Сроки hrtimer, пропущенные из-за опоздания обработчика
+static ssize_t overruns_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct rt_channel *ch = dev_get_drvdata(dev);
+
+    return sysfs_emit(buf, "%lu\n", READ_ONCE(ch->overruns));
+}
+static DEVICE_ATTR_RO(overruns);
+
+static struct attribute *rt_channel_attrs[] = {
+    &dev_attr_percentiles.attr,
+    &dev_attr_interval_us.attr,
+    &dev_attr_cpu.attr,
+    &dev_attr_overruns.attr,
+    NULL,
+};
+ATTRIBUTE_GROUP(rt_channel);
+
+// Статистика реакций по одному значению в файле: mydriver*/stats/.
+// Каждое чтение сворачивает счётчики процессоров без блокировок и не
+// мешает измерению; запись 1 в reset начинает статистику и гистограмму
+// заново. Чтение p50..p999 гистограмму не сбрасывает.
+#define RT_STATS_ATTR(_name, _expr)                                             \
+static ssize_t _name##_show(struct device *dev, struct device_attribute *attr,  \
+                            char *buf)                                          \
+{                                                                               \
+    struct rt_channel *ch = dev_get_drvdata(dev);                               \
+    struct rt_stats s;                                                          \
+                                                                                \
+    rt_stats_fold(ch, &s);                                                      \
+    return sysfs_emit(buf, "%llu\n", (unsigned long long)(_expr));              \
+}                                                                               \
+static DEVICE_ATTR_RO(_name)
+
+RT_STATS_ATTR(count, s.count);
+RT_STATS_ATTR(mean, s.count ? div64_u64(s.sum, s.count) : 0);
+RT_STATS_ATTR(min, s.count ? s.min : 0);
+RT_STATS_ATTR(max, s.max);
+RT_STATS_ATTR(variance, rt_stats_variance(&s));
+RT_STATS_ATTR(stddev, int_sqrt64(rt_stats_variance(&s)));
+RT_STATS_ATTR(duplicate, s.duplicate);
+RT_STATS_ATTR(late, s.late);
+
+#define RT_PERCENTILE_ATTR(_name)                                               \
+static ssize_t _name##_show(struct device *dev, struct device_attribute *attr,  \
+                            char *buf)                                          \
+{                                                                               \
+    struct rt_channel *ch = dev_get_drvdata(dev);                               \
+    struct rt_hist_report r;                                                    \
+                                                                                \
+    rt_hist_report(ch, &r, false);                                              \
+    return sysfs_emit(buf, "%llu\n", r._name);                                  \
+}                                                                               \
+static DEVICE_ATTR_RO(_name)
+
+RT_PERCENTILE_ATTR(p50);
+RT_PERCENTILE_ATTR(p90);
+RT_PERCENTILE_ATTR(p99);
+RT_PERCENTILE_ATTR(p999);
+
+static ssize_t reset_store(struct device *dev, struct device_attribute *attr,
+                           const char *buf, size_t count)
+{
+    struct rt_channel *ch = dev_get_drvdata(dev);
+    bool reset;
+    int ret = kstrtobool(buf, &reset);
+
+    if (ret)
+        return ret;
+    if (reset)
+        rt_stats_reset(ch);
+    return count;
+}
+static DEVICE_ATTR_WO(reset);
+
+static struct attribute *rt_stats_attrs[] = {
+    &dev_attr_count.attr,
+    &dev_attr_mean.attr,
+    &dev_attr_min.attr,
+    &dev_attr_max.attr,
+    &dev_attr_variance.attr,
+    &dev_attr_stddev.attr,
+    &dev_attr_duplicate.attr,
+    &dev_attr_late.attr,
+    &dev_attr_p50.attr,
+    &dev_attr_p90.attr,
+    &dev_attr_p99.attr,
+    &dev_attr_p999.attr,
+    &dev_attr_reset.attr,
+    NULL,
+};
+
+static const struct attribute_group rt_stats_group = {
+    .name = "stats",
+    .attrs = rt_stats_attrs,
+};
+
+static const struct attribute_group *rt_channel_groups[] = {
+    &rt_channel_group,
+    &rt_stats_group,
+    NULL,
+};
+
+static void rt_set_all_intervals(u64 interval_ns)
+{
+    unsigned int i;
+
+    // До загрузки каналов параметр задаёт только значение по умолчанию
+    mutex_lock(&rt_channels_lock);
+    for (i = 0; i < rt_nr_channels; i++)
+        WRITE_ONCE(rt_channels[i].interval_ns, interval_ns);
+    mutex_unlock(&rt_channels_lock);
+}
+
+static u64 stim_jitter_ns(void)
+{
+    unsigned int jitter = READ_ONCE(jitter_us);
+
+    return jitter ? (u64)get_random_u32_below(jitter + 1) * NSEC_PER_USEC : 0;
+}
+
+// "Внешнее воздействие": запоминаем его время и будим ожидающих. В лог
+// ничего не пишем — это добавило бы шум в измеряемую задержку.
+static void stim_fire(struct rt_channel *ch, ktime_t t)
+{
+    u64 seq = ch->stim_seq + 1;
+    struct rt_stim *slot = &ch->history[seq % RT_STIM_HISTORY];
+    struct rt_evfd *e;
+
+    // Воздействие, уходящее из истории без ответа, пропущено
+    if (slot->seq && atomic64_read(&slot->answered) != slot->seq)
+        WRITE_ONCE(ch->stim_missed, ch->stim_missed + 1);
+
+    WRITE_ONCE(slot->seq, 0);
+    smp_wmb();
+    WRITE_ONCE(slot->start_ns, ktime_to_ns(t));
+    smp_store_release(&slot->seq, seq);
+    // Читатель, увидевший новый номер, видит и слот
+    smp_store_release(&ch->stim_seq, seq);
+
+    if (wq_has_sleeper(&ch->stim_wq))
+        wake_up_interruptible_poll(&ch->stim_wq, EPOLLIN | EPOLLRDNORM);
+
+    rcu_read_lock();
+    list_for_each_entry_rcu(e, &ch->evfd_list, node)
+        eventfd_signal(e->ctx);
+    rcu_read_unlock();
+}
+
+// Функция, вызываемая таймером. Таймер привязанного канала создан с
+// TIMER_PINNED и перезапускается на том же процессоре.
 static void my_timer_callback(struct timer_list *t)
 {
-    // Фиксируем время начала "воздействия"
-    start_time = ktime_get();
+    struct rt_channel *ch = from_timer(ch, t, timer);
 
-    // Здесь генерируем "внешнее воздействие" - просто выводим сообщение в лог ядра
-    printk(KERN_INFO "mydriver: Timer fired! (simulated external event)\n");
+    // Фиксируем время начала "воздействия"
+    stim_fire(ch, ktime_get());
 
     // Перезапускаем таймер
-    mod_timer(&my_timer, jiffies + msecs_to_jiffies(interval_ms));
+    mod_timer(&ch->timer, jiffies + nsecs_to_jiffies(READ_ONCE(ch->interval_ns) + stim_jitter_ns()));
+}
+
+// То же на hrtimer. Начало воздействия — запланированный срок, а не момент
+// входа в обработчик, поэтому задержка прерывания входит во время реакции.
+static enum hrtimer_restart my_hrtimer_callback(struct hrtimer *t)
+{
+    struct rt_channel *ch = container_of(t, struct rt_channel, hrtimer);
+    u64 interval = READ_ONCE(ch->interval_ns);
+    ktime_t now = hrtimer_cb_get_time(t);
+
+    stim_fire(ch, hrtimer_get_expires(t));
+
+    // Следующий срок по сетке от прошлого, а не от текущего времени.
+    // Если обработчик опоздал больше чем на период, пропущенные сроки
+    // не навёрстываем, а считаем.
+    ch->stim_base = ktime_add_ns(ch->stim_base, interval);
+    if (ktime_before(ch->stim_base, now)) {
+        u64 missed = div64_u64(ktime_to_ns(ktime_sub(now, ch->stim_base)), interval) + 1;
+
+        WRITE_ONCE(ch->overruns, ch->overruns + missed);
+        ch->stim_base = ktime_add_ns(ch->stim_base, missed * interval);
+    }
+    hrtimer_set_expires(t, ktime_add_ns(ch->stim_base, stim_jitter_ns()));
+    return HRTIMER_RESTART;
+}
+
+// Запуск hrtimer на текущем процессоре. Для привязанного канала вызывается
+// на его процессоре: перезапуск из обработчика оставляет таймер там же.
+static void stim_hrtimer_start(void *arg)
+{
+    struct rt_channel *ch = arg;
+    enum hrtimer_mode mode = ch->cpu >= 0 ? HRTIMER_MODE_ABS_PINNED : HRTIMER_MODE_ABS;
+
+    ch->stim_base = ktime_add_ns(ktime_get(), READ_ONCE(ch->interval_ns));
+    hrtimer_start(&ch->hrtimer, ktime_add_ns(ch->stim_base, stim_jitter_ns()), mode);
+}
+
+static void stim_start(struct rt_channel *ch)
+{
+    if (stim_hrtimer) {
+        hrtimer_init(&ch->hrtimer, CLOCK_MONOTONIC,
+                     ch->cpu >= 0 ? HRTIMER_MODE_ABS_PINNED : HRTIMER_MODE_ABS);
+        ch->hrtimer.function = my_hrtimer_callback;
+        if (ch->cpu >= 0)
+            smp_call_function_single(ch->cpu, stim_hrtimer_start, ch, 1);
+        else
+            stim_hrtimer_start(ch);
+    } else {
+        timer_setup(&ch->timer, my_timer_callback, ch->cpu >= 0 ? TIMER_PINNED : 0);
+        ch->timer.expires = jiffies + nsecs_to_jiffies(READ_ONCE(ch->interval_ns));
+        if (ch->cpu >= 0)
+            add_timer_on(&ch->timer, ch->cpu);
+        else
+            add_timer(&ch->timer);
+    }
+}
+
+static void stim_stop(struct rt_channel *ch)
+{
+    if (stim_hrtimer)
+        hrtimer_cancel(&ch->hrtimer);
+    else
+        del_timer_sync(&ch->timer);
+}
+
+static void rt_channels_destroy(void)
+{
+    struct rt_channel *chs;
+    unsigned int i, nr;
+
+    // Сначала убираем каналы из виду параметров модуля, потом освобождаем
+    mutex_lock(&rt_channels_lock);
+    chs = rt_channels;
+    nr = rt_nr_channels;
+    rt_channels = NULL;
+    rt_nr_channels = 0;
+    mutex_unlock(&rt_channels_lock);
+
+    for (i = 0; i < nr; i++) {
+        struct rt_channel *ch = &chs[i];
+
+        stim_stop(ch);
+        device_destroy(mydriverClass, MKDEV(majorNumber, i));
+        rt_channel_free(ch);
+    }
+    kvfree(chs);
 }
 
 // Функция инициализации модуля - вызывается при загрузке драйвера
 static int __init mydriver_init(void)
 {
+    struct device *dev;
+    unsigned int i;
+    int ret;
+
     printk(KERN_INFO "mydriver: Initializing the mydriver LKM\n");
 
+    if (!strcmp(stimulus, "hrtimer")) {
+        stim_hrtimer = true;
+    } else if (strcmp(stimulus, "timer")) {
+        printk(KERN_ALERT "mydriver: unknown stimulus %s\n", stimulus);
+        return -EINVAL;
+    }
+    if (channels == 0 || channels > RT_MAX_CHANNELS) {
+        printk(KERN_ALERT "mydriver: channels must be 1..%d\n", RT_MAX_CHANNELS);
+        return -EINVAL;
+    }
+
+    // Проверка параметров хранилища времён реакций
+    ret = rt_store_config();
+    if (ret)
+        return ret;
+
+    rt_channels = kvcalloc(channels, sizeof(*rt_channels), GFP_KERNEL);
+    if (!rt_channels)
+        return -ENOMEM;
+
     // Регистрация старшего номера устройства
     majorNumber = register_chrdev(0, DEVICE_NAME, &fops);
     if (majorNumber<0){
         printk(KERN_ALERT "mydriver failed to register a major number\n");
+        kvfree(rt_channels);
         return majorNumber;
     }
     printk(KERN_INFO "mydriver: registered correctly with major number %d\n", majorNumber);
@@ -79,156 +1122,486 @@ static int __init mydriver_init(void)
     mydriverClass = class_create(CLASS_NAME);
     if (IS_ERR(mydriverClass)){
         unregister_chrdev(majorNumber, DEVICE_NAME);
+        kvfree(rt_channels);
         printk(KERN_ALERT "Failed to register device class\n");
         return PTR_ERR(mydriverClass);
     }
     printk(KERN_INFO "mydriver: device class registered correctly\n");
 
-    // Регистрация драйвера устройства
-    mydriverDevice = device_create(mydriverClass, NULL, MKDEV(majorNumber, 0), NULL, DEVICE_NAME);
-    if (IS_ERR(mydriverDevice)){
-        class_destroy(mydriverClass);
-        unregister_chrdev(majorNumber, DEVICE_NAME);
-        printk(KERN_ALERT "Failed to create the device\n");
-        return PTR_ERR(mydriverDevice);
-    }
-    printk(KERN_INFO "mydriver: device class created correctly\n");
+    // Каналы: хранилище, устройство и таймер воздействий. Канал 0 —
+    // /dev/mydriver, остальные /dev/mydriverN.
+    for (i = 0; i < channels; i++) {
+        struct rt_channel *ch = &rt_channels[i];
 
-    // Инициализация таймера
-    timer_setup(&my_timer, my_timer_callback, 0);
-    mod_timer(&my_timer, jiffies + msecs_to_jiffies(interval_ms));
+        ret = rt_channel_init(ch, i);
+        if (ret)
+            goto err;
+
+        // Запуск таймера воздействий. Канал считается созданным до
+        // появления устройства, чтобы open его сразу находил.
+        stim_start(ch);
+        mutex_lock(&rt_channels_lock);
+        rt_nr_channels++;
+        mutex_unlock(&rt_channels_lock);
+
+        if (i == 0)
+            dev = device_create_with_groups(mydriverClass, NULL, MKDEV(majorNumber, i), ch,
+                                            rt_channel_groups, "%s", DEVICE_NAME);
+        else
+            dev = device_create_with_groups(mydriverClass, NULL, MKDEV(majorNumber, i), ch,
+                                            rt_channel_groups, "%s%u", DEVICE_NAME, i);
+        if (IS_ERR(dev)) {
+            printk(KERN_ALERT "Failed to create the device\n");
+            ret = PTR_ERR(dev);
+            goto err;
+        }
+    }
+    printk(KERN_INFO "mydriver: %u channel(s) created correctly\n", channels);
 
     return 0;
+
+err:
+    rt_channels_destroy();
+    class_destroy(mydriverClass);
+    unregister_chrdev(majorNumber, DEVICE_NAME);
+    return ret;
 }
 
 // Функция выгрузки модуля - вызывается при выгрузке драйвера
 static void __exit mydriver_exit(void)
 {
-    // Удаление таймера
-    del_timer(&my_timer);
-
-    // Удаление устройства
-    device_destroy(mydriverClass, MKDEV(majorNumber, 0));
+    // Удаление таймеров, устройств и хранилищ каналов
+    rt_channels_destroy();
     // Удаление класса устройства
     class_destroy(mydriverClass);
     // Отмена регистрации старшего номера устройства
     unregister_chrdev(majorNumber, DEVICE_NAME);
 
-    // Обнуляем переменные, относящиеся ко второму пункту
-    num_reactions = 0;
-    sum_reaction_times = 0;
-    min_reaction_time = ULLONG_MAX;
-    max_reaction_time = 0;
+    printk(KERN_INFO "mydriver: Goodbye!\n");
+}
+
 
-    // Обнуляем индекс массива времен реакций
-    current_index = 0;
+// Состояние чтения отчёта для одного открытого файла. Позиция 0 — строка
+// со сводкой (в двоичном формате — заголовок), позиция k — k-я запись
+// снимка, слитого по времени.
+struct rt_seq_state {
+    struct rt_channel *ch;
+    struct rt_iter iter;
+    loff_t pos;               // позиция записи в cur
+    bool has_cur;
+    struct rt_sample cur;
+    int format;               // RT_FORMAT_*
+    u64 ev_seen;              // последнее прочитанное воздействие
+    struct rt_evfd *evfd;
 
-    printk(KERN_INFO "mydriver: Goodbye!\n");
+    // Снимок для mmap: заголовок и записи в vmalloc_user-области
+    struct mutex snap_lock;
+    void *snap;
+    size_t snap_size;
+    atomic_t snap_maps;       // живые отображения снимка
+};
+
+static void rt_export_hdr_fill(struct rt_export_hdr *hdr, u32 flags, u64 count, u64 lost)
+{
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = cpu_to_le32(RT_EXPORT_MAGIC);
+    hdr->version = cpu_to_le16(RT_EXPORT_VERSION);
+    hdr->header_size = cpu_to_le16(sizeof(*hdr));
+    hdr->record_size = cpu_to_le32(sizeof(struct rt_export_rec));
+    hdr->flags = cpu_to_le32(flags);
+    hdr->count = cpu_to_le64(count);
+    hdr->lost = cpu_to_le64(lost);
 }
 
+static void rt_export_rec_fill(struct rt_export_rec *rec, const struct rt_sample *sample)
+{
+    rec->timestamp_ns = cpu_to_le64(sample->timestamp_ns);
+    rec->latency_ns = cpu_to_le64(sample->latency_ns);
+    rec->cpu = cpu_to_le32(sample->cpu);
+    rec->reserved = 0;
+}
 
-static int dev_open(struct inode *inodep, struct file *filep){
-   printk(KERN_INFO "mydriver: Device has been opened\n");
-   return 0;
+// Продвигает итератор до позиции pos. Назад (lseek или новое чтение с
+// начала) — через новый снимок.
+static void *rt_seq_seek(struct rt_seq_state *st, loff_t pos)
+{
+    if (pos < st->pos || (pos == st->pos && !st->has_cur)) {
+        rt_iter_rewind(&st->iter);
+        st->pos = 0;
+        st->has_cur = false;
+    }
+    while (st->pos < pos) {
+        if (!rt_iter_next(&st->iter, &st->cur))
+            return NULL;
+        st->has_cur = true;
+        st->pos++;
+    }
+    return &st->cur;
+}
+
+static void *rt_seq_start(struct seq_file *m, loff_t *pos)
+{
+    struct rt_seq_state *st = m->private;
+
+    if (*pos == 0) {
+        rt_iter_rewind(&st->iter);
+        st->pos = 0;
+        st->has_cur = false;
+        return SEQ_START_TOKEN;
+    }
+    return rt_seq_seek(st, *pos);
+}
+
+static void *rt_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+    ++*pos;
+    return rt_seq_seek(m->private, *pos);
 }
 
-static ssize_t dev_read(struct file *filep, char *buffer, size_t len, loff_t *offset) {
-    int error_count = 0;
-    char message[256];
-    int message_len;
-    static bool data_read = false;
-    size_t total_sent = 0; // Общее количество байт, отправленных пользователю
+static void rt_seq_stop(struct seq_file *m, void *v)
+{
+}
+
+static int rt_seq_show(struct seq_file *m, void *v)
+{
+    struct rt_seq_state *st = m->private;
+    const struct rt_sample *sample = v;
+
+    if (st->format == RT_FORMAT_BINARY) {
+        struct rt_export_hdr hdr;
+        struct rt_export_rec rec;
+
+        if (v == SEQ_START_TOKEN) {
+            rt_export_hdr_fill(&hdr, RT_EXPORT_STREAM, 0, 0);
+            seq_write(m, &hdr, sizeof(hdr));
+        } else {
+            rt_export_rec_fill(&rec, sample);
+            seq_write(m, &rec, sizeof(rec));
+        }
+        return 0;
+    }
+
+    if (v == SEQ_START_TOKEN) {
+        struct rt_stats stats;
 
-    if (data_read) {
-        data_read = false;
+        // Рассчитываем среднее время реакции
+        unsigned long long avg_reaction_time = 0;
+        rt_stats_fold(st->ch, &stats);
+        if (stats.count > 0) {
+            avg_reaction_time = div64_u64(stats.sum, stats.count);
+        }
+        seq_printf(m, "Average: %llu ns, Max: %llu ns, Min: %llu ns, Missed: %llu, Duplicate: %llu, Late: %llu\n",
+                   avg_reaction_time, stats.max, stats.min,
+                   READ_ONCE(st->ch->stim_missed), stats.duplicate, stats.late);
         return 0;
     }
 
-    // Рассчитываем среднее время реакции
-    unsigned long long avg_reaction_time = 0;
-    if (num_reactions > 0) {
-        avg_reaction_time = sum_reaction_times / num_reactions;
+    seq_printf(m, "%llu ns\n", sample->latency_ns);
+    return 0;
+}
+
+static const struct seq_operations rt_seq_ops = {
+    .start = rt_seq_start,
+    .next = rt_seq_next,
+    .stop = rt_seq_stop,
+    .show = rt_seq_show,
+};
+
+static int dev_open(struct inode *inodep, struct file *filep){
+    unsigned int minor = iminor(inodep);
+    struct rt_seq_state *st;
+    int ret;
+
+    if (minor >= rt_nr_channels)
+        return -ENODEV;
+
+    st = __seq_open_private(filep, &rt_seq_ops, sizeof(*st));
+    if (!st)
+        return -ENOMEM;
+
+    st->ch = &rt_channels[minor];
+    ret = rt_iter_init(&st->iter, st->ch);
+    if (ret) {
+        seq_release_private(inodep, filep);
+        return ret;
     }
+    st->format = RT_FORMAT_TEXT;
+    mutex_init(&st->snap_lock);
+    atomic_set(&st->snap_maps, 0);
+    return 0;
+}
 
-    // Формируем строку с результатами
-    message_len = snprintf(message, sizeof(message), "Average: %llu ns, Max: %llu ns, Min: %llu ns\n",
-                           avg_reaction_time, max_reaction_time, min_reaction_time);
+// Снимает все записи в новую область для mmap. Итератор отдельный, чтобы
+// не сбивать позицию read.
+static int rt_snapshot(struct rt_seq_state *st, u64 *size)
+{
+    struct rt_export_rec *rec;
+    struct rt_sample sample;
+    struct rt_iter it;
+    u64 bound = 0, count = 0;
+    size_t area_size;
+    void *area;
+    int cpu, ret;
 
-    if (message_len >= sizeof(message)) {
-        printk(KERN_WARNING "mydriver: Message too long\n");
-        return -EINVAL;
+    ret = rt_iter_init(&it, st->ch);
+    if (ret)
+        return ret;
+    for_each_possible_cpu(cpu)
+        bound += it.cursors[cpu].end - it.cursors[cpu].next;
+
+    area_size = PAGE_ALIGN(sizeof(struct rt_export_hdr) + bound * sizeof(*rec));
+    area = vmalloc_user(area_size);
+    if (!area) {
+        rt_iter_destroy(&it);
+        return -ENOMEM;
     }
 
-    // Копируем данные в пользовательское пространство
-    error_count = copy_to_user(buffer, message, message_len);
-    
-    if (error_count != 0) {
-        printk(KERN_INFO "mydriver: Failed to send %d characters to the user\n", error_count);
-        return -EFAULT;
+    rec = area + sizeof(struct rt_export_hdr);
+    while (count < bound && rt_iter_next(&it, &sample))
+        rt_export_rec_fill(&rec[count++], &sample);
+    rt_export_hdr_fill(area, 0, count, it.lost);
+    rt_iter_destroy(&it);
+
+    mutex_lock(&st->snap_lock);
+    if (atomic_read(&st->snap_maps)) {
+        mutex_unlock(&st->snap_lock);
+        vfree(area);
+        return -EBUSY;
     }
+    vfree(st->snap);
+    st->snap = area;
+    st->snap_size = area_size;
+    mutex_unlock(&st->snap_lock);
 
-    printk(KERN_INFO "mydriver: Sent %d characters to the user\n", message_len);
-    total_sent += message_len;
+    *size = sizeof(struct rt_export_hdr) + count * sizeof(*rec);
+    return 0;
+}
 
-    // Выводим все времена реакций
-    for (unsigned long long i = 0; i < current_index; i++) {
-        message_len = snprintf(message, sizeof(message), "%llu ns\n", reaction_times[i]);
+// Регистрация eventfd открытого файла; fd < 0 снимает её
+static int rt_set_eventfd(struct rt_seq_state *st, int fd)
+{
+    struct rt_evfd *e = NULL, *old;
 
-        if (message_len >= sizeof(message)) {
-            printk(KERN_WARNING "mydriver: Message too long\n");
-            return -EINVAL;
-        }
+    if (fd >= 0) {
+        e = kmalloc(sizeof(*e), GFP_KERNEL);
+        if (!e)
+            return -ENOMEM;
+        e->ctx = eventfd_ctx_fdget(fd);
+        if (IS_ERR(e->ctx)) {
+            int ret = PTR_ERR(e->ctx);
 
-        if (total_sent + message_len > len) {
-            printk(KERN_WARNING "mydriver: Not enough space in user buffer\n");
-            break; // Прерываем цикл, если не хватает места в буфере
+            kfree(e);
+            return ret;
         }
+    }
+
+    spin_lock(&rt_evfd_lock);
+    old = st->evfd;
+    if (old)
+        list_del_rcu(&old->node);
+    if (e)
+        list_add_tail_rcu(&e->node, &st->ch->evfd_list);
+    st->evfd = e;
+    spin_unlock(&rt_evfd_lock);
+
+    if (old) {
+        synchronize_rcu();
+        eventfd_ctx_put(old->ctx);
+        kfree(old);
+    }
+    return 0;
+}
+
+// Ожидание следующего воздействия в формате RT_FORMAT_EVENTS
+static ssize_t rt_read_event(struct rt_seq_state *st, struct file *filep,
+                             char __user *buffer, size_t len)
+{
+    struct rt_channel *ch = st->ch;
+    struct rt_event ev;
+    u64 seq;
+    int ret;
+
+    if (len < sizeof(ev))
+        return -EINVAL;
+
+    if (READ_ONCE(ch->stim_seq) == st->ev_seen) {
+        if (filep->f_flags & O_NONBLOCK)
+            return -EAGAIN;
+        ret = wait_event_interruptible(ch->stim_wq, READ_ONCE(ch->stim_seq) != st->ev_seen);
+        if (ret)
+            return ret;
+    }
+
+    seq = smp_load_acquire(&ch->stim_seq);
+    ev.seq = seq;
+    if (rt_stim_start(ch, seq, &ev.stimulus_ns))
+        ev.stimulus_ns = 0;
+    st->ev_seen = seq;
+    if (copy_to_user(buffer, &ev, sizeof(ev)))
+        return -EFAULT;
+    return sizeof(ev);
+}
+
+static ssize_t dev_read(struct file *filep, char __user *buffer, size_t len, loff_t *offset)
+{
+    struct seq_file *m = filep->private_data;
+    struct rt_seq_state *st = m->private;
 
-        error_count = copy_to_user(buffer + total_sent, message, message_len);
+    if (st->format == RT_FORMAT_EVENTS)
+        return rt_read_event(st, filep, buffer, len);
+    return seq_read(filep, buffer, len, offset);
+}
+
+static __poll_t dev_poll(struct file *filep, poll_table *wait)
+{
+    struct seq_file *m = filep->private_data;
+    struct rt_seq_state *st = m->private;
+    __poll_t mask = EPOLLOUT | EPOLLWRNORM;
 
-        if (error_count != 0) {
-            printk(KERN_INFO "mydriver: Failed to send %d characters to the user\n", error_count);
+    if (st->format != RT_FORMAT_EVENTS)
+        return mask | EPOLLIN | EPOLLRDNORM;
+
+    poll_wait(filep, &st->ch->stim_wq, wait);
+    if (READ_ONCE(st->ch->stim_seq) != st->ev_seen)
+        mask |= EPOLLIN | EPOLLRDNORM;
+    return mask;
+}
+
+static long dev_ioctl(struct file *filep, unsigned int cmd, unsigned long arg)
+{
+    struct seq_file *m = filep->private_data;
+    struct rt_seq_state *st = m->private;
+    struct rt_hist_report report;
+    u64 size, seq;
+    int ret, val;
+
+    switch (cmd) {
+    case IOCTL_SET_FORMAT:
+        if (get_user(val, (int __user *)arg))
             return -EFAULT;
+        if (val != RT_FORMAT_TEXT && val != RT_FORMAT_BINARY && val != RT_FORMAT_EVENTS)
+            return -EINVAL;
+        // seq_read начинает заново только с нулевой позиции
+        mutex_lock(&m->lock);
+        if (filep->f_pos != 0)
+            ret = -EBUSY;
+        else {
+            // Ждём воздействий, случившихся после переключения
+            st->ev_seen = smp_load_acquire(&st->ch->stim_seq);
+            st->format = val;
+            ret = 0;
         }
-        printk(KERN_INFO "mydriver: Sent %d characters to the user\n", message_len);
-        total_sent += message_len;
+        mutex_unlock(&m->lock);
+        return ret;
+    case IOCTL_SNAPSHOT:
+        ret = rt_snapshot(st, &size);
+        if (ret)
+            return ret;
+        return put_user(size, (u64 __user *)arg);
+    case IOCTL_HIST_REPORT:
+        if (copy_from_user(&report, (void __user *)arg, sizeof(report)))
+            return -EFAULT;
+        if (report.flags & ~RT_HIST_RESET)
+            return -EINVAL;
+        rt_hist_report(st->ch, &report, report.flags & RT_HIST_RESET);
+        if (copy_to_user((void __user *)arg, &report, sizeof(report)))
+            return -EFAULT;
+        return 0;
+    case IOCTL_SET_EVENTFD:
+        if (get_user(val, (int __user *)arg))
+            return -EFAULT;
+        return rt_set_eventfd(st, val);
+    case IOCTL_RESPOND:
+        if (get_user(seq, (u64 __user *)arg))
+            return -EFAULT;
+        return rt_respond(st->ch, ktime_get_ns(), seq);
+    default:
+        return -ENOTTY;
     }
+}
 
-    data_read = true;
-    return (size_t)total_sent;
+static void rt_vma_open(struct vm_area_struct *vma)
+{
+    struct rt_seq_state *st = vma->vm_private_data;
+
+    atomic_inc(&st->snap_maps);
 }
 
-static ssize_t dev_write(struct file *filep, const char *buffer, size_t len, loff_t *offset){
-    // Фиксируем время реакции
-    reaction_time = ktime_sub(ktime_get(), start_time);
-    unsigned long long reaction_time_ns = ktime_to_ns(reaction_time);
+static void rt_vma_close(struct vm_area_struct *vma)
+{
+    struct rt_seq_state *st = vma->vm_private_data;
 
-    // Обновляем статистику
-    num_reactions++;
-    sum_reaction_times += reaction_time_ns;
+    atomic_dec(&st->snap_maps);
+}
 
-    if (reaction_time_ns < min_reaction_time) {
-        min_reaction_time = reaction_time_ns;
-    }
-    if (reaction_time_ns > max_reaction_time) {
-        max_reaction_time = reaction_time_ns;
+static const struct vm_operations_struct rt_vm_ops = {
+    .open = rt_vma_open,
+    .close = rt_vma_close,
+};
+
+// Отображение последнего снимка IOCTL_SNAPSHOT только для чтения. snap_lock
+// под mmap_lock брать можно: с ним не копируются данные пользователя.
+static int dev_mmap(struct file *filep, struct vm_area_struct *vma)
+{
+    struct seq_file *m = filep->private_data;
+    struct rt_seq_state *st = m->private;
+    unsigned long len = vma->vm_end - vma->vm_start;
+    int ret;
+
+    if (vma->vm_pgoff != 0)
+        return -EINVAL;
+    if (vma->vm_flags & VM_WRITE)
+        return -EPERM;
+    vm_flags_clear(vma, VM_MAYWRITE);
+
+    mutex_lock(&st->snap_lock);
+    if (!st->snap)
+        ret = -ENODATA;
+    else if (len > st->snap_size)
+        ret = -EINVAL;
+    else
+        ret = remap_vmalloc_range(vma, st->snap, 0);
+    if (!ret) {
+        atomic_inc(&st->snap_maps);
+        vma->vm_ops = &rt_vm_ops;
+        vma->vm_private_data = st;
     }
+    mutex_unlock(&st->snap_lock);
+    return ret;
+}
 
-    // Добавляем время реакции в массив
-    if (current_index < MAX_REACTIONS) {
-        reaction_times[current_index] = reaction_time_ns;
-        current_index++;
-    } else {
-        printk(KERN_WARNING "mydriver: Maximum number of reactions reached, not storing new values\n");
+static ssize_t dev_write(struct file *filep, const char *buffer, size_t len, loff_t *offset){
+    // Фиксируем время реакции до копирования данных
+    u64 now = ktime_get_ns();
+    struct seq_file *m = filep->private_data;
+    struct rt_seq_state *st = m->private;
+    struct rt_response resp;
+    int ret;
+
+    if (len == sizeof(resp)) {
+        if (copy_from_user(&resp, (const char __user *)buffer, sizeof(resp)))
+            return -EFAULT;
+        if (resp.magic == RT_RESPONSE_MAGIC) {
+            ret = rt_respond(st->ch, now, resp.seq);
+            return ret ? ret : len;
+        }
     }
 
-    printk(KERN_INFO "mydriver: Device write, reaction time: %llu ns\n", reaction_time_ns);
+    // Ответ без номера относится к последнему воздействию. Повторы
+    // учитываются, но запись не отвергается, чтобы работал echo.
+    rt_respond(st->ch, now, smp_load_acquire(&st->ch->stim_seq));
     return len;
 }
 
 static int dev_release(struct inode *inodep, struct file *filep){
-   printk(KERN_INFO "mydriver: Device successfully closed\n");
-   return 0;
+    struct seq_file *m = filep->private_data;
+    struct rt_seq_state *st = m->private;
+
+    rt_set_eventfd(st, -1);
+    rt_iter_destroy(&st->iter);
+    // Отображения держат ссылку на файл, поэтому к release их уже нет
+    vfree(st->snap);
+    return seq_release_private(inodep, filep);
 }
 
 // Макросы для регистрации функций инициализации и выгрузки
@@ -0,0 +1,100 @@
+#ifndef MYDRIVER_H
+#define MYDRIVER_H
+
+// Общие определения драйвера и пользовательских программ
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+// Канал 0; остальные каналы — /dev/mydriver1, /dev/mydriver2, ...
+#define MYDRIVER_DEVICE_PATH "/dev/mydriver"
+
+// Формат отчёта, выдаваемого read. Меняется только в начале файла
+// (до чтения или после lseek(fd, 0, SEEK_SET)), иначе -EBUSY. Аргумент —
+// указатель на int с форматом, как объявлено в _IOW.
+#define RT_FORMAT_TEXT   0   // строка со сводкой, затем "<latency> ns\n"
+#define RT_FORMAT_BINARY 1   // struct rt_export_hdr, затем struct rt_export_rec
+#define RT_FORMAT_EVENTS 2   // struct rt_event на каждое воздействие, см. ниже
+
+#define IOCTL_SET_FORMAT _IOW('r', 1, int)
+
+// Снимок всех записей для mmap. Возвращает в аргументе размер снимка в
+// байтах; затем mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) отображает
+// заголовок и записи. Пока снимок отображён, новый снять нельзя (-EBUSY).
+#define IOCTL_SNAPSHOT _IOR('r', 2, __u64)
+
+// Двоичный формат: заголовок, за ним записи фиксированной длины.
+// Все поля little-endian. Читатель должен пропустить header_size байт и
+// читать записи по record_size байт: новые поля добавляются только в конец.
+#define RT_EXPORT_MAGIC   0x31535452   // "RTS1"
+#define RT_EXPORT_VERSION 1
+
+#define RT_EXPORT_STREAM  0x1   // поток read: count и lost неизвестны, записи до конца файла
+
+struct rt_export_hdr {
+    __le32 magic;
+    __le16 version;
+    __le16 header_size;
+    __le32 record_size;
+    __le32 flags;       // RT_EXPORT_*
+    __le64 count;       // число записей в снимке
+    __le64 lost;        // записи, перезаписанные во время снятия
+};
+
+struct rt_export_rec {
+    __le64 timestamp_ns;    // момент ответа, CLOCK_MONOTONIC
+    __le64 latency_ns;
+    __le32 cpu;
+    __le32 reserved;
+};
+
+// Распределение задержек из гистограммы драйвера. Гистограмма
+// лог-линейная: значения меньше 32 нс точные, остальные попадают в корзины
+// шириной 1/32 от степени двойки. Перцентили возвращаются серединой
+// корзины, поэтому относительная ошибка не больше 1/64 (~1.6%).
+// С флагом RT_HIST_RESET после чтения отсчёт начинается заново.
+#define RT_HIST_RESET 0x1
+
+struct rt_hist_report {
+    __u32 flags;        // RT_HIST_* (на входе)
+    __u32 reserved;
+    __u64 count;
+    __u64 p50;
+    __u64 p90;
+    __u64 p99;
+    __u64 p999;
+    __u64 max;
+};
+
+#define IOCTL_HIST_REPORT _IOWR('r', 3, struct rt_hist_report)
+
+// Ожидание воздействий. В формате RT_FORMAT_EVENTS read блокируется до
+// следующего воздействия после последнего прочитанного и возвращает его
+// описание; poll сообщает POLLIN, когда оно произошло. Пропуски видны по
+// разрыву в seq. Без ожидания в read (O_NONBLOCK) возвращается -EAGAIN.
+struct rt_event {
+    __u64 seq;          // номер воздействия, с 1
+    __u64 stimulus_ns;  // момент воздействия, CLOCK_MONOTONIC; 0, если он уже не в истории
+};
+
+// Регистрация eventfd, который получает 1 на каждое воздействие. Аргумент —
+// указатель на int с дескриптором eventfd или -1, чтобы снять регистрацию.
+// Один на открытый файл.
+#define IOCTL_SET_EVENTFD _IOW('r', 4, int)
+
+// Ответ на конкретное воздействие: write ровно этой структуры или
+// IOCTL_RESPOND с номером. Любая другая запись считается ответом на
+// последнее воздействие, как раньше. Повторный ответ (-EALREADY) и ответ на
+// воздействие, вышедшее из истории драйвера (-ETIME), не учитываются во
+// времени реакции, а считаются отдельно.
+#define RT_RESPONSE_MAGIC 0x31525452   // "RTR1"
+
+struct rt_response {
+    __u32 magic;
+    __u32 reserved;
+    __u64 seq;          // rt_event.seq
+};
+
+#define IOCTL_RESPOND _IOW('r', 5, __u64)
+
+#endif
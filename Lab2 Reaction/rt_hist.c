@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <endian.h>
+
+#include "mydriver.h"
+
+// Анализ времён реакций из отчёта драйвера: текстового ("<latency> ns" по
+// строке, строка со сводкой пропускается) или двоичного (struct
+// rt_export_hdr и записи). Данные читаются потоком, память не зависит от
+// объёма: значения сразу попадают в лог-линейную гистограмму (как в
+// драйвере, но с 128 корзинами на степень двойки — ошибка перцентилей не
+// больше 0.4%). Минимум, максимум, среднее и отклонение точные.
+
+#define SUB_BITS 7
+#define SUB (1U << SUB_BITS)
+#define BUCKETS ((64 - SUB_BITS + 1) << SUB_BITS)
+#define CHUNK (1 << 20)
+
+struct run {
+    const char *name;
+    uint64_t counts[BUCKETS];
+    uint64_t n, min, max;
+    long double sum, sum_sq;
+    int binary;
+    uint64_t lost;
+};
+
+static unsigned bucket_index(uint64_t v) {
+    unsigned e;
+
+    if (v < SUB)
+        return v;
+    e = 63 - __builtin_clzll(v);
+    return ((e - SUB_BITS + 1) << SUB_BITS) + ((v >> (e - SUB_BITS)) & (SUB - 1));
+}
+
+// Середина корзины
+static uint64_t bucket_value(unsigned idx) {
+    unsigned e;
+
+    if (idx < SUB)
+        return idx;
+    e = (idx >> SUB_BITS) + SUB_BITS - 1;
+    return (1ULL << e) + ((uint64_t)(idx & (SUB - 1)) << (e - SUB_BITS)) +
+           (1ULL << (e - SUB_BITS) >> 1);
+}
+
+static inline void add_value(struct run *r, uint64_t v) {
+    r->counts[bucket_index(v)]++;
+    if (!r->n || v < r->min)
+        r->min = v;
+    if (v > r->max)
+        r->max = v;
+    r->n++;
+    r->sum += v;
+    r->sum_sq += (long double)v * v;
+}
+
+// Текст: число в начале строки, остальное до конца строки игнорируется.
+// Строки, начинающиеся не с цифры, пропускаются.
+static void parse_text(struct run *r, FILE *f, char *buf, size_t len) {
+    enum { LINE_START, NUMBER, SKIP } state = LINE_START;
+    uint64_t v = 0;
+
+    do {
+        for (size_t i = 0; i < len; i++) {
+            unsigned char c = buf[i];
+
+            switch (state) {
+            case LINE_START:
+                if ((unsigned)(c - '0') < 10) {
+                    v = c - '0';
+                    state = NUMBER;
+                } else if (c != '\n') {
+                    state = SKIP;
+                }
+                break;
+            case NUMBER:
+                if ((unsigned)(c - '0') < 10) {
+                    v = v * 10 + (c - '0');
+                    break;
+                }
+                add_value(r, v);
+                state = c == '\n' ? LINE_START : SKIP;
+                break;
+            case SKIP:
+                if (c == '\n')
+                    state = LINE_START;
+                break;
+            }
+        }
+    } while ((len = fread(buf, 1, CHUNK, f)) > 0);
+
+    if (state == NUMBER)
+        add_value(r, v);
+}
+
+// Двоичный формат: заголовок header_size байт, затем записи по
+// record_size байт; из записи нужен только latency_ns. В снимке (без
+// RT_EXPORT_STREAM) читаем только count записей: дальше может идти
+// выравнивание до страницы.
+static int parse_binary(struct run *r, FILE *f, char *buf, size_t len) {
+    struct rt_export_hdr hdr;
+    size_t header_size, record_size, off;
+    uint64_t left = UINT64_MAX;
+
+    if (len < sizeof(hdr)) {
+        fprintf(stderr, "%s: truncated header\n", r->name);
+        return -1;
+    }
+    memcpy(&hdr, buf, sizeof(hdr));
+    header_size = le16toh(hdr.header_size);
+    record_size = le32toh(hdr.record_size);
+    r->binary = 1;
+    r->lost = le64toh(hdr.lost);
+    if (!(le32toh(hdr.flags) & RT_EXPORT_STREAM) && hdr.count)
+        left = le64toh(hdr.count);
+    if (header_size < sizeof(hdr) || record_size < sizeof(struct rt_export_rec) ||
+        record_size > CHUNK || header_size > len) {
+        fprintf(stderr, "%s: unsupported header (version %u)\n", r->name, le16toh(hdr.version));
+        return -1;
+    }
+
+    off = header_size;
+    for (;;) {
+        while (left && len - off >= record_size) {
+            uint64_t v;
+
+            memcpy(&v, buf + off + offsetof(struct rt_export_rec, latency_ns), sizeof(v));
+            add_value(r, le64toh(v));
+            off += record_size;
+            left--;
+        }
+        if (!left)
+            return 0;
+        // Остаток неполной записи переносим в начало буфера
+        memmove(buf, buf + off, len - off);
+        len -= off;
+        off = 0;
+        size_t got = fread(buf + len, 1, CHUNK - len, f);
+        if (!got)
+            break;
+        len += got;
+    }
+    if (len)
+        fprintf(stderr, "%s: %zu trailing bytes ignored\n", r->name, len);
+    return 0;
+}
+
+static int load(struct run *r, char *buf) {
+    FILE *f = strcmp(r->name, "-") ? fopen(r->name, "rb") : stdin;
+    size_t len;
+    uint32_t magic;
+    int ret = 0;
+
+    if (!f) {
+        perror(r->name);
+        return -1;
+    }
+    len = fread(buf, 1, CHUNK, f);
+    if (len >= sizeof(magic))
+        memcpy(&magic, buf, sizeof(magic));
+    if (len >= sizeof(magic) && le32toh(magic) == RT_EXPORT_MAGIC)
+        ret = parse_binary(r, f, buf, len);
+    else
+        parse_text(r, f, buf, len);
+    if (f != stdin)
+        fclose(f);
+    return ret;
+}
+
+static uint64_t percentile(const struct run *r, double p) {
+    uint64_t rank = (uint64_t)ceil(p / 100 * r->n), seen = 0;
+
+    if (!rank)
+        rank = 1;
+    for (unsigned i = 0; i < BUCKETS; i++) {
+        seen += r->counts[i];
+        if (seen >= rank) {
+            uint64_t v = bucket_value(i);
+            // Середина корзины не выходит за точные границы
+            return v < r->min ? r->min : v > r->max ? r->max : v;
+        }
+    }
+    return r->max;
+}
+
+// Столбцы гистограммы собираются из мелких корзин по их серединам. При
+// равных значениях (max == min) получается один столбец.
+static void print_histogram(const struct run *r, int nbins, int log_scale) {
+    uint64_t *bins = calloc(nbins, sizeof(*bins)), peak = 0;
+    double lo = r->min, hi = r->max;
+    double span = log_scale ? log((hi + 1) / (lo + 1)) : hi - lo;
+
+    if (span <= 0)
+        nbins = 1;
+    for (unsigned i = 0; i < BUCKETS; i++) {
+        if (!r->counts[i])
+            continue;
+        double v = bucket_value(i);
+        v = v < lo ? lo : v > hi ? hi : v;
+        double pos = span <= 0 ? 0 : log_scale ? log((v + 1) / (lo + 1)) / span : (v - lo) / span;
+        int b = (int)(pos * nbins);
+        if (b >= nbins)
+            b = nbins - 1;
+        bins[b] += r->counts[i];
+    }
+    for (int b = 0; b < nbins; b++)
+        if (bins[b] > peak)
+            peak = bins[b];
+
+    printf("Text Histogram%s:\n", log_scale ? " (log scale)" : "");
+    for (int b = 0; b < nbins; b++) {
+        double from = log_scale ? (lo + 1) * exp(span * b / nbins) - 1 : lo + span * b / nbins;
+        double to = log_scale ? (lo + 1) * exp(span * (b + 1) / nbins) - 1 : lo + span * (b + 1) / nbins;
+        int width = peak ? (int)(bins[b] * 40 / peak) : 0;
+
+        printf("%.0f-%.0f ns: %.*s (%llu)\n", from, to, width,
+               "****************************************", (unsigned long long)bins[b]);
+    }
+    free(bins);
+}
+
+#define NPCT 5
+static const double pct_values[NPCT] = { 50, 90, 99, 99.9, 99.99 };
+static const char *pct_names[NPCT] = { "p50", "p90", "p99", "p99.9", "p99.99" };
+
+static void print_header(void) {
+    printf("%-24s %12s %12s %12s %12s", "run", "count", "min", "mean", "stddev");
+    for (int i = 0; i < NPCT; i++)
+        printf(" %12s", pct_names[i]);
+    printf(" %12s\n", "max");
+}
+
+static void print_summary(const struct run *r) {
+    long double mean = r->n ? r->sum / r->n : 0;
+    long double var = r->n ? r->sum_sq / r->n - mean * mean : 0;
+
+    printf("%-24s %12llu %12llu %12.0Lf %12.0Lf", r->name, (unsigned long long)r->n,
+           (unsigned long long)r->min, mean, var > 0 ? sqrtl(var) : 0);
+    for (int i = 0; i < NPCT; i++)
+        printf(" %12llu", (unsigned long long)percentile(r, pct_values[i]));
+    printf(" %12llu\n", (unsigned long long)r->max);
+}
+
+// Изменение перцентилей относительно первого прогона
+static void print_compare(const struct run *base, const struct run *r) {
+    printf("%-24s %12s %12s", r->name, "", "");
+    printf(" %+11.1f%% %12s", base->n && r->n ?
+           (double)(r->sum / r->n) / (double)(base->sum / base->n) * 100 - 100 : 0.0, "");
+    for (int i = 0; i < NPCT; i++) {
+        double b = percentile(base, pct_values[i]), c = percentile(r, pct_values[i]);
+        printf(" %+11.1f%%", b ? c / b * 100 - 100 : 0.0);
+    }
+    printf(" %+11.1f%%\n", base->max ? (double)r->max / base->max * 100 - 100 : 0.0);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-b bins] [-l] [-q] file... (- для stdin)\n"
+            "  -b  число столбцов гистограммы (10)\n"
+            "  -l  логарифмическая шкала столбцов\n"
+            "  -q  без гистограмм, только сводка\n"
+            "Несколько файлов сравниваются с первым.\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    int nbins = 10, log_scale = 0, quiet = 0, c;
+    char *buf;
+
+    while ((c = getopt(argc, argv, "b:lqh")) != -1) {
+        switch (c) {
+        case 'b': nbins = atoi(optarg); break;
+        case 'l': log_scale = 1; break;
+        case 'q': quiet = 1; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind == argc || nbins < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int nruns = argc - optind;
+    struct run *runs = calloc(nruns, sizeof(*runs));
+    buf = malloc(CHUNK);
+    if (!runs || !buf) {
+        perror("malloc");
+        return 1;
+    }
+
+    for (int i = 0; i < nruns; i++) {
+        runs[i].name = argv[optind + i];
+        if (load(&runs[i], buf))
+            return 1;
+        if (!runs[i].n) {
+            fprintf(stderr, "Error: No samples in '%s'.\n", runs[i].name);
+            return 1;
+        }
+        if (runs[i].lost)
+            fprintf(stderr, "Warning: %s: %llu samples were overwritten while reading.\n",
+                    runs[i].name, (unsigned long long)runs[i].lost);
+        if (!quiet) {
+            if (nruns > 1)
+                printf("== %s\n", runs[i].name);
+            print_histogram(&runs[i], nbins, log_scale);
+            printf("\n");
+        }
+    }
+
+    print_header();
+    for (int i = 0; i < nruns; i++)
+        print_summary(&runs[i]);
+    if (nruns > 1) {
+        printf("\nvs %s:\n", runs[0].name);
+        for (int i = 1; i < nruns; i++)
+            print_compare(&runs[0], &runs[i]);
+    }
+
+    free(runs);
+    free(buf);
+    return 0;
+}
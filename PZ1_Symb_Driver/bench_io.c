@@ -0,0 +1,214 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <linux/io_uring.h>
+
+#include "pz1_symb_drv.h"
+
+// Сравнение способов прочитать буфер из FIELDS полей за итерацию:
+// отдельные pread, один preadv, пакет io_uring и splice через канал в /dev/null
+
+#define MAX_FIELDS 64
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, long iterations, size_t bytes, long syscalls, double elapsed) {
+    printf("%-8s %9.1f ns/iter  %10.1f MiB/s  %5.2f syscalls/iter\n", name,
+           elapsed * 1e9 / iterations, bytes * (double)iterations / elapsed / (1 << 20),
+           (double)syscalls / iterations);
+}
+
+// Минимальная обёртка io_uring без liburing
+struct uring {
+    int fd;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+};
+
+static int uring_init(struct uring *ring, unsigned entries) {
+    struct io_uring_params p;
+    void *sq, *cq;
+
+    memset(&p, 0, sizeof(p));
+    ring->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->fd < 0)
+        return -1;
+
+    sq = mmap(NULL, p.sq_off.array + p.sq_entries * sizeof(unsigned), PROT_READ | PROT_WRITE,
+              MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    cq = mmap(NULL, p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe),
+              PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (sq == MAP_FAILED || cq == MAP_FAILED || ring->sqes == MAP_FAILED)
+        return -1;
+
+    ring->sq_tail = sq + p.sq_off.tail;
+    ring->sq_mask = sq + p.sq_off.ring_mask;
+    ring->sq_array = sq + p.sq_off.array;
+    ring->cq_head = cq + p.cq_off.head;
+    ring->cq_tail = cq + p.cq_off.tail;
+    ring->cq_mask = cq + p.cq_off.ring_mask;
+    ring->cqes = cq + p.cq_off.cqes;
+    return 0;
+}
+
+static void uring_prep_read(struct uring *ring, int fd, void *buf, unsigned len, off_t off) {
+    unsigned tail = *ring->sq_tail;
+    unsigned idx = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long)buf;
+    sqe->len = len;
+    sqe->off = off;
+    ring->sq_array[idx] = idx;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// Отправка n запросов и ожидание всех завершений одним системным вызовом
+static int uring_submit_wait(struct uring *ring, unsigned n) {
+    unsigned head, done = 0;
+
+    if (syscall(__NR_io_uring_enter, ring->fd, n, n, IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+        return -1;
+    head = *ring->cq_head;
+    while (done < n) {
+        if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+            continue;
+        if (ring->cqes[head & *ring->cq_mask].res < 0)
+            return -1;
+        head++;
+        done++;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int size = argc > 1 ? atoi(argv[1]) : 4096;
+    int fields = argc > 2 ? atoi(argv[2]) : 8;
+    long iterations = argc > 3 ? atol(argv[3]) : 100000;
+    struct iovec iov[MAX_FIELDS];
+    struct uring ring;
+    int field_len, pipefd[2], devnull;
+    double start;
+    char *buf;
+
+    if (fields < 1 || fields > MAX_FIELDS || size < fields) {
+        fprintf(stderr, "usage: %s [size] [fields<=%d] [iterations]\n", argv[0], MAX_FIELDS);
+        return 1;
+    }
+    field_len = size / fields;
+    size = field_len * fields;
+
+    int fd = open(PZ1_DEVICE_PATH, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open device");
+        return 1;
+    }
+    if (ioctl(fd, IOCTL_RESET_BUFFER, &size) < 0) {
+        fprintf(stderr, "ioctl failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    buf = malloc(size);
+    if (!buf) {
+        perror("malloc");
+        return 1;
+    }
+    memset(buf, 'x', size);
+    if (pwrite(fd, buf, size, 0) != size) {
+        perror("pwrite");
+        return 1;
+    }
+    for (int i = 0; i < fields; i++) {
+        iov[i].iov_base = buf + i * field_len;
+        iov[i].iov_len = field_len;
+    }
+
+    printf("payload %d bytes in %d fields of %d bytes, %ld iterations\n", size, fields, field_len,
+           iterations);
+
+    start = now_sec();
+    for (long it = 0; it < iterations; it++) {
+        for (int i = 0; i < fields; i++) {
+            if (pread(fd, iov[i].iov_base, field_len, i * field_len) != field_len) {
+                perror("pread");
+                return 1;
+            }
+        }
+    }
+    report("read", iterations, size, (long)fields * iterations, now_sec() - start);
+
+    start = now_sec();
+    for (long it = 0; it < iterations; it++) {
+        if (preadv(fd, iov, fields, 0) != size) {
+            perror("preadv");
+            return 1;
+        }
+    }
+    report("readv", iterations, size, iterations, now_sec() - start);
+
+    if (uring_init(&ring, MAX_FIELDS) < 0) {
+        printf("%-8s unavailable: %s\n", "io_uring", strerror(errno));
+    } else {
+        start = now_sec();
+        for (long it = 0; it < iterations; it++) {
+            for (int i = 0; i < fields; i++)
+                uring_prep_read(&ring, fd, iov[i].iov_base, field_len, i * field_len);
+            if (uring_submit_wait(&ring, fields) < 0) {
+                perror("io_uring");
+                return 1;
+            }
+        }
+        report("io_uring", iterations, size, iterations, now_sec() - start);
+        close(ring.fd);
+    }
+
+    // splice: устройство -> канал -> /dev/null без копирования в память процесса
+    devnull = open("/dev/null", O_WRONLY);
+    if (devnull < 0 || pipe(pipefd) < 0) {
+        perror("pipe");
+        return 1;
+    }
+    fcntl(pipefd[1], F_SETPIPE_SZ, size);
+    start = now_sec();
+    for (long it = 0; it < iterations; it++) {
+        loff_t off = 0;
+        ssize_t left = size;
+        while (left > 0) {
+            ssize_t n = splice(fd, &off, pipefd[1], NULL, left, SPLICE_F_MOVE);
+            if (n <= 0 || splice(pipefd[0], NULL, devnull, NULL, n, SPLICE_F_MOVE) != n) {
+                perror("splice");
+                return 1;
+            }
+            left -= n;
+        }
+    }
+    report("splice", iterations, size, iterations * 2, now_sec() - start);
+
+    close(pipefd[0]);
+    close(pipefd[1]);
+    close(devnull);
+    free(buf);
+    close(fd);
+    return 0;
+}
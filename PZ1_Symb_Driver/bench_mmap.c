@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "pz1_symb_drv.h"
+
+// Сравнение пропускной способности чтения буфера через read() и через mmap
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, long iterations, size_t bytes, double elapsed) {
+    printf("%-6s %10ld iter  %8.1f ns/iter  %10.1f MiB/s\n", name, iterations,
+           elapsed * 1e9 / iterations, bytes * (double)iterations / elapsed / (1 << 20));
+}
+
+int main(int argc, char *argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+    int fd = open(PZ1_DEVICE_PATH, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open device");
+        return 1;
+    }
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    struct pz1_shared_hdr *hdr = mmap(NULL, page_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (hdr == MAP_FAILED) {
+        fprintf(stderr, "mmap failed: %s\n", strerror(errno));
+        close(fd);
+        return 1;
+    }
+    size_t map_len = hdr->data_offset + hdr->capacity;
+    munmap(hdr, page_size);
+
+    hdr = mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0);
+    if (hdr == MAP_FAILED) {
+        fprintf(stderr, "mmap failed: %s\n", strerror(errno));
+        close(fd);
+        return 1;
+    }
+    const char *data = (const char *)hdr + hdr->data_offset;
+
+    size_t size = hdr->size;
+    char *buf = malloc(hdr->capacity);
+    if (!buf) {
+        perror("malloc");
+        return 1;
+    }
+
+    double start = now_sec();
+    for (long i = 0; i < iterations; i++) {
+        if (pread(fd, buf, size, 0) < 0) {
+            fprintf(stderr, "read failed: %s\n", strerror(errno));
+            return 1;
+        }
+    }
+    report("read", iterations, size, now_sec() - start);
+
+    start = now_sec();
+    for (long i = 0; i < iterations; i++) {
+        pz1_mmap_read(hdr, data, buf, size);
+    }
+    report("mmap", iterations, size, now_sec() - start);
+
+    free(buf);
+    munmap(hdr, map_len);
+    close(fd);
+    return 0;
+}
@@ -4,99 +4,895 @@
 #include <linux/uaccess.h>
 #include <linux/cdev.h>
 #include <linux/device.h>
+#include <linux/vmalloc.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#include <linux/log2.h>
+#include <linux/rcupdate.h>
+#include <linux/srcu.h>
+#include <linux/refcount.h>
+#include <linux/moduleparam.h>
+#include <linux/percpu.h>
+#include <linux/uio.h>
+#include <linux/splice.h>
+
+#include "pz1_symb_drv.h"
+
+#define CREATE_TRACE_POINTS
+#include "pz1_symb_drv_trace.h"
 
 #define DRIVER_NAME "pz1_symb_drv"
 #define BUFFER_SIZE 1024
 
-// Глобальный буфер
-static char global_buffer[BUFFER_SIZE];
-static int buffer_size = BUFFER_SIZE;
+static unsigned int max_buffer_size = 1 << 20;
+module_param(max_buffer_size, uint, 0444);
+MODULE_PARM_DESC(max_buffer_size, "Maximum buffer size in bytes");
+
+static unsigned int num_devices = 1;
+module_param(num_devices, uint, 0444);
+MODULE_PARM_DESC(num_devices, "Number of device minors, each with its own buffer");
+
+static bool private_buffers = false;
+module_param(private_buffers, bool, 0444);
+MODULE_PARM_DESC(private_buffers, "Give every open file its own private buffer");
+
+// Общая область для mmap: страница заголовка, затем данные буфера
+#define SHARED_AREA_SIZE(size) (PAGE_SIZE + PAGE_ALIGN(size))
+
+// Сколько раз чтение без блокировки повторяется из-за параллельной записи,
+// прежде чем взять write_lock
+#define READ_RETRIES 16
+
+// Дескриптор общей области. Читатели обычного режима находят его под
+// pz1_srcu и ссылок не берут: заменённая область освобождается через
+// call_srcu, когда все начатые чтения закончатся. Ссылки держат только
+// владельцы — устройство и mmap на время отображения. Счётчик ссылок
+// вынесен из строки с полями, которые читает каждый вызов read.
+struct pz1_buf {
+    struct pz1_shared_hdr *hdr;
+    char *data;
+    void *area;
+    size_t area_size;
+
+    refcount_t ref ____cacheline_aligned_in_smp;
+    struct rcu_head rcu;
+};
+
+// Копирование в пространство пользователя может уснуть на отказе страницы,
+// поэтому читатели защищены SRCU, а не rcu_read_lock
+DEFINE_STATIC_SRCU(pz1_srcu);
+
+// Секции владельцев сторон FIFO, работающих без мьютекса (см. fifo_enter)
+DEFINE_STATIC_SRCU(pz1_fifo_srcu);
+
+// Состояние одного буфера: по одному на минор или на открытый файл
+// в режиме private_buffers
+struct pz1_dev {
+    struct pz1_buf __rcu *buf;
+
+    // Меняются только под write_lock и read_lock одновременно
+    int buffer_size;
+    int buffer_mode;
+
+    // Число живых mmap-отображений: пока оно не ноль, область нельзя перевыделить
+    atomic_t mmap_count;
 
-// Мажорный и минорный номер устройства
+    // Кольцо режима FIFO поверх buffer. Индексы свободно растут,
+    // позиция в буфере — индекс & (buffer_size - 1). head меняет только
+    // писатель, tail — только читатель. Всё, что пишет одна сторона
+    // (индекс, блокировка и очередь, которую она будит), лежит в своей
+    // кэш-линии, чтобы писатель и читатель не делили строки.
+    //
+    // Порядок захвата: write_lock, read_lock. Читатели обычного режима
+    // блокировок не берут, владельцы сторон FIFO — тоже (см. fifo_enter).
+
+    // Сторона писателя. write_lock сериализует писателей (изменения
+    // буфера и счётчика seq), read_wq будит читателей после записи.
+    // fifo_writer — файл, пишущий в кольцо без write_lock,
+    // nr_writers — число файлов, открытых на запись.
+    unsigned int head ____cacheline_aligned_in_smp;
+    struct mutex write_lock;
+    wait_queue_head_t read_wq;
+    struct file *fifo_writer;
+    atomic_t nr_writers;
+
+    // Сторона читателя FIFO. read_lock сериализует читателей, write_wq
+    // будит писателей после чтения.
+    unsigned int tail ____cacheline_aligned_in_smp;
+    struct mutex read_lock;
+    wait_queue_head_t write_wq;
+    struct file *fifo_reader;
+    atomic_t nr_readers;
+};
+
+// Счётчики вызовов по процессорам: обновляются без блокировок и атомарных
+// операций, суммируются при чтении атрибутов в /sys/class/pz1_symb_drv/
+struct pz1_stats {
+    u64 read_calls;
+    u64 read_bytes;
+    u64 write_calls;
+    u64 write_bytes;
+    u64 ioctl_calls;
+    u64 errors;
+};
+
+static DEFINE_PER_CPU(struct pz1_stats, pz1_stats);
+
+// Мажорный номер устройства и устройства по минорам
 static int major_number;
 static struct cdev cdev;
+static struct pz1_dev **devices;
 
-// Указатели на struct class и struct device
+// Указатель на struct class
 static struct class *dev_class;
-static struct device *dev_device;
 
 // Функции для работы с устройством
 static int dev_open(struct inode *, struct file *);
 static int dev_release(struct inode *, struct file *);
-static ssize_t dev_read(struct file *, char __user *, size_t, loff_t *);
-static ssize_t dev_write(struct file *, const char __user *, size_t, loff_t *);
+static ssize_t dev_read_iter(struct kiocb *, struct iov_iter *);
+static ssize_t dev_write_iter(struct kiocb *, struct iov_iter *);
 static long dev_ioctl(struct file *, unsigned int, unsigned long);
+static int dev_mmap(struct file *, struct vm_area_struct *);
+static __poll_t dev_poll(struct file *, poll_table *);
 
 // Структура с описанием операций над файлом
 static struct file_operations fops = {
+    .owner = THIS_MODULE,
     .open = dev_open,
     .release = dev_release,
-    .read = dev_read,
-    .write = dev_write,
+    .read_iter = dev_read_iter,
+    .write_iter = dev_write_iter,
+    .splice_read = copy_splice_read,
+    .splice_write = iter_file_splice_write,
     .unlocked_ioctl = dev_ioctl,
+    .mmap = dev_mmap,
+    .poll = dev_poll,
 };
 
+// Выделение общей области с выравниванием по страницам
+static struct pz1_buf *pz1_buf_alloc(int size) {
+    struct pz1_buf *buf;
+
+    buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+    if (!buf)
+        return NULL;
+
+    buf->area_size = SHARED_AREA_SIZE(size);
+    buf->area = vmalloc_user(buf->area_size);
+    if (!buf->area) {
+        kfree(buf);
+        return NULL;
+    }
+    refcount_set(&buf->ref, 1);
+    buf->hdr = buf->area;
+    buf->hdr->capacity = buf->area_size - PAGE_SIZE;
+    buf->hdr->data_offset = PAGE_SIZE;
+    buf->data = buf->area + PAGE_SIZE;
+    return buf;
+}
+
+static void pz1_buf_free_rcu(struct rcu_head *rcu) {
+    struct pz1_buf *buf = container_of(rcu, struct pz1_buf, rcu);
+
+    vfree(buf->area);
+    kfree(buf);
+}
+
+// Ссылка на текущий дескриптор для mmap. Если дескриптор уже заменён и
+// отпущен, повторяем с новым.
+static struct pz1_buf *pz1_buf_get(struct pz1_dev *dev) {
+    struct pz1_buf *buf;
+    int idx;
+
+    idx = srcu_read_lock(&pz1_srcu);
+    do {
+        buf = srcu_dereference(dev->buf, &pz1_srcu);
+    } while (!refcount_inc_not_zero(&buf->ref));
+    srcu_read_unlock(&pz1_srcu, idx);
+    return buf;
+}
+
+static void pz1_buf_put(struct pz1_buf *buf) {
+    if (refcount_dec_and_test(&buf->ref))
+        call_srcu(&pz1_srcu, &buf->rcu, pz1_buf_free_rcu);
+}
+
+// Текущий дескриптор для владельца write_lock или read_lock
+static struct pz1_buf *pz1_buf_locked(struct pz1_dev *dev) {
+    return rcu_dereference_protected(dev->buf, lockdep_is_held(&dev->write_lock) ||
+                                               lockdep_is_held(&dev->read_lock));
+}
+
+// Создание буфера начального размера
+static struct pz1_dev *pz1_dev_create(void) {
+    struct pz1_dev *dev;
+    struct pz1_buf *buf;
+
+    dev = kzalloc(sizeof(*dev), GFP_KERNEL);
+    if (!dev)
+        return NULL;
+
+    dev->buffer_size = BUFFER_SIZE;
+    dev->buffer_mode = PZ1_MODE_FLAT;
+    buf = pz1_buf_alloc(dev->buffer_size);
+    if (!buf) {
+        kfree(dev);
+        return NULL;
+    }
+    buf->hdr->size = dev->buffer_size;
+    buf->hdr->mode = dev->buffer_mode;
+    RCU_INIT_POINTER(dev->buf, buf);
+
+    init_waitqueue_head(&dev->read_wq);
+    init_waitqueue_head(&dev->write_wq);
+    mutex_init(&dev->write_lock);
+    mutex_init(&dev->read_lock);
+    atomic_set(&dev->mmap_count, 0);
+    atomic_set(&dev->nr_readers, 0);
+    atomic_set(&dev->nr_writers, 0);
+    return dev;
+}
+
+static void pz1_dev_destroy(struct pz1_dev *dev) {
+    if (!dev)
+        return;
+    pz1_buf_put(rcu_dereference_protected(dev->buf, 1));
+    kfree(dev);
+}
+
+// Начало и конец изменения буфера: seq нечётный, пока данные неконсистентны.
+// Этот же счётчик служит seqcount для читателей в ядре.
+static void shared_write_begin(struct pz1_buf *buf) {
+    WRITE_ONCE(buf->hdr->seq, buf->hdr->seq + 1);
+    smp_wmb();
+}
+
+static void shared_write_end(struct pz1_buf *buf) {
+    smp_wmb();
+    WRITE_ONCE(buf->hdr->seq, buf->hdr->seq + 1);
+}
+
+// Снятие владельца стороны FIFO: после возврата он больше не работает
+// без мьютекса и снова захватит сторону через него. Вызывается под
+// мьютексом стороны.
+static void fifo_revoke(struct file **owner) {
+    if (!*owner)
+        return;
+    WRITE_ONCE(*owner, NULL);
+    synchronize_srcu(&pz1_fifo_srcu);
+}
+
+// Учёт файла на стороне FIFO. Второй файл на стороне снимает владельца,
+// и дальше все её файлы работают под мьютексом.
+static void fifo_attach(struct mutex *lock, struct file **owner, atomic_t *users) {
+    if (atomic_inc_return(users) == 1)
+        return;
+    mutex_lock(lock);
+    fifo_revoke(owner);
+    mutex_unlock(lock);
+}
+
+static void fifo_detach(struct mutex *lock, struct file **owner, atomic_t *users,
+                        struct file *file) {
+    mutex_lock(lock);
+    if (*owner == file)
+        WRITE_ONCE(*owner, NULL);
+    atomic_dec(users);
+    mutex_unlock(lock);
+}
+
 static int dev_open(struct inode *inode, struct file *file) {
-    printk(KERN_INFO "pz1_symb_drv: Device opened\n");
+    struct pz1_dev *dev;
+
+    if (private_buffers) {
+        dev = pz1_dev_create();
+        if (!dev)
+            return -ENOMEM;
+    } else {
+        dev = devices[iminor(inode)];
+    }
+    file->private_data = dev;
+
+    if (file->f_mode & FMODE_READ)
+        fifo_attach(&dev->read_lock, &dev->fifo_reader, &dev->nr_readers);
+    if (file->f_mode & FMODE_WRITE)
+        fifo_attach(&dev->write_lock, &dev->fifo_writer, &dev->nr_writers);
+
+    // Пути чтения и записи соблюдают IOCB_NOWAIT
+    file->f_mode |= FMODE_NOWAIT;
     return 0;
 }
 
 static int dev_release(struct inode *inode, struct file *file) {
-    printk(KERN_INFO "pz1_symb_drv: Device closed\n");
+    struct pz1_dev *dev = file->private_data;
+
+    // Отображения держат ссылку на файл, поэтому к этому моменту их уже нет
+    if (private_buffers) {
+        pz1_dev_destroy(dev);
+        return 0;
+    }
+
+    if (file->f_mode & FMODE_READ)
+        fifo_detach(&dev->read_lock, &dev->fifo_reader, &dev->nr_readers, file);
+    if (file->f_mode & FMODE_WRITE)
+        fifo_detach(&dev->write_lock, &dev->fifo_writer, &dev->nr_writers, file);
     return 0;
 }
 
-static ssize_t dev_read(struct file *file, char __user *user_buffer, size_t count, loff_t *offset) {
-    int bytes_to_copy;
-    int bytes_copied;
+static unsigned int ring_used(struct pz1_dev *dev) {
+    return READ_ONCE(dev->head) - READ_ONCE(dev->tail);
+}
+
+static bool fifo_readable(struct pz1_dev *dev) {
+    return ring_used(dev) || READ_ONCE(dev->buffer_mode) != PZ1_MODE_FIFO;
+}
 
-    bytes_to_copy = min((int)count, (int)(buffer_size - *offset));
-    bytes_copied = copy_to_user(user_buffer, global_buffer + *offset, bytes_to_copy);
+static bool fifo_writable(struct pz1_dev *dev) {
+    return ring_used(dev) < READ_ONCE(dev->buffer_size) ||
+           READ_ONCE(dev->buffer_mode) != PZ1_MODE_FIFO;
+}
 
-    if (bytes_copied) {
-        printk(KERN_ERR "pz1_symb_drv: Failed to copy %d bytes to user\n", bytes_copied);
-        return -EFAULT;
+// Запрос не должен блокироваться: O_NONBLOCK или IOCB_NOWAIT от io_uring
+static bool pz1_nowait(struct kiocb *iocb) {
+    return (iocb->ki_filp->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT);
+}
+
+static int pz1_lock(struct mutex *lock, bool nowait) {
+    if (nowait)
+        return mutex_trylock(lock) ? 0 : -EAGAIN;
+    mutex_lock(lock);
+    return 0;
+}
+
+// Вход на сторону кольца. Если у стороны открыт один файл, он становится
+// её владельцем и дальше проходит без мьютекса: только секция
+// pz1_fifo_srcu, индексы публикуются через acquire/release. Остальные
+// (и владелец, которого сняли) берут мьютекс стороны; под ним сторону и
+// захватывают. Как и у kfifo, владельца не читают (не пишут) из нескольких
+// потоков одновременно. В *idx возвращается индекс SRCU или -1 под мьютексом.
+static int fifo_enter(struct mutex *lock, struct file **owner, atomic_t *users,
+                      struct file *file, bool nowait, int *idx) {
+    int ret;
+
+    if (READ_ONCE(*owner) == file) {
+        *idx = srcu_read_lock(&pz1_fifo_srcu);
+        // Повторная проверка в секции: fifo_revoke ждёт только начатые секции
+        if (READ_ONCE(*owner) == file)
+            return 0;
+        srcu_read_unlock(&pz1_fifo_srcu, *idx);
+    }
+
+    ret = pz1_lock(lock, nowait);
+    if (ret)
+        return ret;
+    if (!*owner && atomic_read(users) == 1)
+        WRITE_ONCE(*owner, file);
+    *idx = -1;
+    return 0;
+}
+
+static void fifo_leave(struct mutex *lock, int idx) {
+    if (idx >= 0)
+        srcu_read_unlock(&pz1_fifo_srcu, idx);
+    else
+        mutex_unlock(lock);
+}
+
+// Чтение из кольца; блокируется, пока кольцо пусто.
+// Если режим сменился во время ожидания, возвращает 0.
+static ssize_t fifo_read(struct kiocb *iocb, struct iov_iter *to) {
+    struct file *file = iocb->ki_filp;
+    struct pz1_dev *dev = file->private_data;
+    bool nowait = pz1_nowait(iocb);
+    unsigned int head, tail, off, chunk;
+    struct pz1_buf *buf;
+    size_t count, copied;
+    ssize_t ret;
+    int idx;
+
+    for (;;) {
+        ret = fifo_enter(&dev->read_lock, &dev->fifo_reader, &dev->nr_readers,
+                         file, nowait, &idx);
+        if (ret)
+            return ret;
+        if (dev->buffer_mode != PZ1_MODE_FIFO) {
+            fifo_leave(&dev->read_lock, idx);
+            return 0;
+        }
+
+        tail = dev->tail;
+        head = smp_load_acquire(&dev->head);
+        if (head != tail)
+            break;
+        fifo_leave(&dev->read_lock, idx);
+
+        if (nowait)
+            return -EAGAIN;
+        if (wait_event_interruptible(dev->read_wq, fifo_readable(dev)))
+            return -ERESTARTSYS;
+    }
+
+    // Без мьютекса buf не защищён lockdep, но заменяют его только после
+    // fifo_revoke. Объём ограничен размером кольца на случай, если
+    // владельца всё же читают из нескольких потоков.
+    buf = rcu_dereference_protected(dev->buf, 1);
+    count = min_t(size_t, iov_iter_count(to),
+                  min_t(unsigned int, head - tail, dev->buffer_size));
+    off = tail & (dev->buffer_size - 1);
+    chunk = min_t(size_t, count, dev->buffer_size - off);
+    copied = copy_to_iter(buf->data + off, chunk, to);
+    if (copied == chunk)
+        copied += copy_to_iter(buf->data, count - chunk, to);
+    if (copied) {
+        // Освобождаем место только после того, как данные скопированы
+        smp_store_release(&dev->tail, tail + copied);
+        ret = copied;
+    } else {
+        ret = count ? -EFAULT : 0;
+    }
+    fifo_leave(&dev->read_lock, idx);
+
+    if (ret > 0 && wq_has_sleeper(&dev->write_wq))
+        wake_up_interruptible(&dev->write_wq);
+    return ret;
+}
+
+// Запись в кольцо; блокируется, пока кольцо заполнено
+static ssize_t fifo_write(struct kiocb *iocb, struct iov_iter *from) {
+    struct file *file = iocb->ki_filp;
+    struct pz1_dev *dev = file->private_data;
+    bool nowait = pz1_nowait(iocb);
+    unsigned int head, tail, off, chunk;
+    struct pz1_buf *buf;
+    size_t count, copied;
+    ssize_t ret;
+    int idx;
+
+    for (;;) {
+        ret = fifo_enter(&dev->write_lock, &dev->fifo_writer, &dev->nr_writers,
+                         file, nowait, &idx);
+        if (ret)
+            return ret;
+        if (dev->buffer_mode != PZ1_MODE_FIFO) {
+            fifo_leave(&dev->write_lock, idx);
+            return 0;
+        }
+
+        head = dev->head;
+        tail = smp_load_acquire(&dev->tail);
+        if (head - tail < dev->buffer_size)
+            break;
+        fifo_leave(&dev->write_lock, idx);
+
+        if (nowait)
+            return -EAGAIN;
+        if (wait_event_interruptible(dev->write_wq, fifo_writable(dev)))
+            return -ERESTARTSYS;
+    }
+
+    buf = rcu_dereference_protected(dev->buf, 1);
+    count = min_t(size_t, iov_iter_count(from), dev->buffer_size - (head - tail));
+    off = head & (dev->buffer_size - 1);
+    chunk = min_t(size_t, count, dev->buffer_size - off);
+    copied = copy_from_iter(buf->data + off, chunk, from);
+    if (copied == chunk)
+        copied += copy_from_iter(buf->data, count - chunk, from);
+    if (copied) {
+        // Публикуем данные читателю
+        smp_store_release(&dev->head, head + copied);
+        ret = copied;
+    } else {
+        ret = count ? -EFAULT : 0;
+    }
+    fifo_leave(&dev->write_lock, idx);
+
+    if (ret > 0 && wq_has_sleeper(&dev->read_wq))
+        wake_up_interruptible(&dev->read_wq);
+    return ret;
+}
+
+// Чтение в обычном режиме без блокировок и без общих атомарных записей:
+// дескриптор держит секция SRCU, копирование повторяется, если во время него
+// буфер менялся (итератор при этом откатывается). Если писатели не дают
+// завершить чтение за READ_RETRIES попыток, берём write_lock.
+static ssize_t flat_read(struct kiocb *iocb, struct iov_iter *to) {
+    struct pz1_dev *dev = iocb->ki_filp->private_data;
+    loff_t pos = iocb->ki_pos;
+    struct pz1_buf *buf;
+    unsigned int seq, size;
+    bool locked = false;
+    size_t count = 0, copied = 0;
+    int tries, idx;
+
+    idx = srcu_read_lock(&pz1_srcu);
+    buf = srcu_dereference(dev->buf, &pz1_srcu);
+    for (tries = 0; ; tries++) {
+        if (tries == READ_RETRIES) {
+            if (pz1_lock(&dev->write_lock, pz1_nowait(iocb))) {
+                srcu_read_unlock(&pz1_srcu, idx);
+                return -EAGAIN;
+            }
+            locked = true;
+        }
+
+        seq = READ_ONCE(buf->hdr->seq);
+        smp_rmb();
+        if (seq & 1) {
+            cpu_relax();
+            continue;
+        }
+
+        size = READ_ONCE(buf->hdr->size);
+        if (pos >= size) {
+            count = 0;
+            copied = 0;
+        } else {
+            count = min_t(size_t, iov_iter_count(to), size - pos);
+            copied = copy_to_iter(buf->data + pos, count, to);
+        }
+
+        smp_rmb();
+        if (locked || READ_ONCE(buf->hdr->seq) == seq)
+            break;
+        iov_iter_revert(to, copied);
+    }
+    if (locked)
+        mutex_unlock(&dev->write_lock);
+    srcu_read_unlock(&pz1_srcu, idx);
+
+    if (!copied)
+        return count ? -EFAULT : 0;
+
+    iocb->ki_pos += copied;
+    return copied;
+}
+
+static ssize_t flat_write(struct kiocb *iocb, struct iov_iter *from) {
+    struct pz1_dev *dev = iocb->ki_filp->private_data;
+    loff_t pos = iocb->ki_pos;
+    struct pz1_buf *buf;
+    size_t count, copied;
+    int ret;
+
+    ret = pz1_lock(&dev->write_lock, pz1_nowait(iocb));
+    if (ret)
+        return ret;
+    if (pos >= dev->buffer_size) {
+        mutex_unlock(&dev->write_lock);
+        return -ENOSPC;
+    }
+    buf = pz1_buf_locked(dev);
+    count = min_t(size_t, iov_iter_count(from), dev->buffer_size - pos);
+    shared_write_begin(buf);
+    copied = copy_from_iter(buf->data + pos, count, from);
+    shared_write_end(buf);
+    mutex_unlock(&dev->write_lock);
+
+    if (!copied)
+        return count ? -EFAULT : 0;
+
+    iocb->ki_pos += copied;
+    return copied;
+}
+
+// Учёт результата вызова; EAGAIN в неблокирующем режиме ошибкой не считается
+static void pz1_account_io(u64 __percpu *calls, u64 __percpu *bytes, ssize_t ret) {
+    this_cpu_inc(*calls);
+    if (ret > 0)
+        this_cpu_add(*bytes, ret);
+    else if (ret < 0 && ret != -EAGAIN)
+        this_cpu_inc(pz1_stats.errors);
+}
+
+// read, readv, io_uring и splice приходят сюда с итератором
+static ssize_t dev_read_iter(struct kiocb *iocb, struct iov_iter *to) {
+    struct pz1_dev *dev = iocb->ki_filp->private_data;
+    int mode = READ_ONCE(dev->buffer_mode);
+    size_t count = iov_iter_count(to);
+    loff_t pos = iocb->ki_pos;
+    ssize_t ret;
+
+    if (mode == PZ1_MODE_FIFO)
+        ret = fifo_read(iocb, to);
+    else
+        ret = flat_read(iocb, to);
+
+    pz1_account_io(&pz1_stats.read_calls, &pz1_stats.read_bytes, ret);
+    trace_pz1_read(iminor(file_inode(iocb->ki_filp)), mode, pos, count, ret);
+    return ret;
+}
+
+static ssize_t dev_write_iter(struct kiocb *iocb, struct iov_iter *from) {
+    struct pz1_dev *dev = iocb->ki_filp->private_data;
+    int mode = READ_ONCE(dev->buffer_mode);
+    size_t count = iov_iter_count(from);
+    loff_t pos = iocb->ki_pos;
+    ssize_t ret;
+
+    if (mode == PZ1_MODE_FIFO)
+        ret = fifo_write(iocb, from);
+    else
+        ret = flat_write(iocb, from);
+
+    pz1_account_io(&pz1_stats.write_calls, &pz1_stats.write_bytes, ret);
+    trace_pz1_write(iminor(file_inode(iocb->ki_filp)), mode, pos, count, ret);
+    return ret;
+}
+
+// Замена общей области на новую под размер new_size. Если keep, данные
+// переносятся: в обычном режиме — префикс буфера, в режиме FIFO —
+// непрочитанная часть кольца, выложенная с начала. Читатели, успевшие взять
+// старый дескриптор, дочитывают из него: он освобождается после их секций SRCU.
+// Вызывается с захваченными write_lock и read_lock.
+static int buffer_realloc(struct pz1_dev *dev, int new_size, bool keep) {
+    struct pz1_buf *old = pz1_buf_locked(dev);
+    unsigned int old_head = dev->head, old_tail = dev->tail;
+    struct pz1_buf *new;
+    unsigned int used, off, chunk;
+
+    if (atomic_read(&dev->mmap_count))
+        return -EBUSY;
+
+    new = pz1_buf_alloc(new_size);
+    if (!new)
+        return -ENOMEM;
+    new->hdr->seq = old->hdr->seq;
+    // Читатели без блокировок видят новую область сразу после публикации,
+    // а окончательный размер вызывающий запишет позже: до этого размер не
+    // должен выходить за новую область
+    new->hdr->size = min_t(u32, old->hdr->size, new_size);
+    new->hdr->mode = old->hdr->mode;
+
+    if (keep && dev->buffer_mode == PZ1_MODE_FIFO) {
+        used = dev->head - dev->tail;
+        off = dev->tail & (dev->buffer_size - 1);
+        chunk = min_t(unsigned int, used, dev->buffer_size - off);
+        memcpy(new->data, old->data + off, chunk);
+        memcpy(new->data + chunk, old->data, used - chunk);
+        dev->tail = 0;
+        dev->head = used;
+    } else if (keep) {
+        memcpy(new->data, old->data, min(dev->buffer_size, new_size));
+    }
+
+    // mmap не берёт блокировок (см. dev_mmap), поэтому отображения
+    // проверяем после замены: либо mmap увидит новый дескриптор при
+    // повторной проверке и вернёт -EAGAIN, либо мы увидим его счётчик и
+    // вернём старую область. Пара к smp_mb() в dev_mmap.
+    rcu_assign_pointer(dev->buf, new);
+    smp_mb();
+    if (atomic_read(&dev->mmap_count)) {
+        rcu_assign_pointer(dev->buf, old);
+        dev->head = old_head;
+        dev->tail = old_tail;
+        pz1_buf_put(new);
+        return -EBUSY;
     }
+    pz1_buf_put(old);
+    return 0;
+}
+
+// Захват устройства целиком: владельцы сторон FIFO снимаются, чтобы
+// перенастройка не шла параллельно с их вызовами без мьютекса
+static void mem_reverse(char *p, size_t n) {
+    size_t i;
 
-    *offset += bytes_to_copy;
-    printk(KERN_INFO "pz1_symb_drv: Read %d bytes from offset %lld\n", bytes_to_copy, *offset - bytes_to_copy);
-    return bytes_to_copy;
+    for (i = 0; i < n / 2; i++)
+        swap(p[i], p[n - 1 - i]);
 }
 
-static ssize_t dev_write(struct file *file, const char __user *user_buffer, size_t count, loff_t *offset) {
-    int bytes_to_copy;
-    int bytes_copied;
+// Изменение размера без перевыделения, когда число страниц то же. Как и в
+// buffer_realloc, непрочитанная часть кольца FIFO выкладывается с начала
+// (поворот тремя разворотами), а байты за новым размером очищаются.
+// Вызывается под buffer_lock_all внутри секции seq.
+static void buffer_resize_in_place(struct pz1_dev *dev, struct pz1_buf *buf, int new_size) {
+    unsigned int used, off;
 
-    bytes_to_copy = min((int)count, (int)(buffer_size - *offset));
-    bytes_copied = copy_from_user(global_buffer + *offset, user_buffer, bytes_to_copy);
+    if (dev->buffer_mode == PZ1_MODE_FIFO) {
+        used = dev->head - dev->tail;
+        off = dev->tail & (dev->buffer_size - 1);
+        mem_reverse(buf->data, off);
+        mem_reverse(buf->data + off, dev->buffer_size - off);
+        mem_reverse(buf->data, dev->buffer_size);
+        dev->tail = 0;
+        dev->head = used;
+    }
+    if (new_size < dev->buffer_size)
+        memset(buf->data + new_size, 0, dev->buffer_size - new_size);
+}
 
-    if (bytes_copied) {
-        printk(KERN_ERR "pz1_symb_drv: Failed to copy %d bytes from user\n", bytes_copied);
+// Захват устройства целиком
+    mutex_lock(&dev->write_lock);
+    mutex_lock(&dev->read_lock);
+    fifo_revoke(&dev->fifo_writer);
+    fifo_revoke(&dev->fifo_reader);
+}
+
+static void buffer_unlock_all(struct pz1_dev *dev) {
+    mutex_unlock(&dev->read_lock);
+    mutex_unlock(&dev->write_lock);
+
+    // Будим ожидающих: режим или размер кольца изменились
+    wake_up_interruptible(&dev->read_wq);
+    wake_up_interruptible(&dev->write_wq);
+}
+
+// Одна операция пакета; вызывается под write_lock
+static int batch_op(struct pz1_dev *dev, struct pz1_buf *buf, struct pz1_batch_op *op) {
+    void __user *ptr = u64_to_user_ptr(op->ptr);
+    struct pz1_stat stat;
+    u64 len;
+
+    if (op->op == PZ1_OP_STAT) {
+        stat.size = dev->buffer_size;
+        stat.mode = dev->buffer_mode;
+        stat.capacity = buf->hdr->capacity;
+        stat.used = ring_used(dev);
+        stat.seq = buf->hdr->seq;
+        if (copy_to_user(ptr, &stat, sizeof(stat)))
+            return -EFAULT;
+        return sizeof(stat);
+    }
+
+    if (dev->buffer_mode != PZ1_MODE_FLAT)
+        return -EINVAL;
+    if (op->offset >= dev->buffer_size)
+        return op->op == PZ1_OP_READ ? 0 : -ENOSPC;
+    len = min_t(u64, op->length, dev->buffer_size - op->offset);
+
+    switch (op->op) {
+        case PZ1_OP_READ:
+            if (copy_to_user(ptr, buf->data + op->offset, len))
+                return -EFAULT;
+            this_cpu_add(pz1_stats.read_bytes, len);
+            return len;
+        case PZ1_OP_WRITE:
+            if (copy_from_user(buf->data + op->offset, ptr, len))
+                return -EFAULT;
+            this_cpu_add(pz1_stats.write_bytes, len);
+            return len;
+        case PZ1_OP_RESET:
+            if (!op->length)
+                len = dev->buffer_size - op->offset;
+            memset(buf->data + op->offset, 0, len);
+            return len;
+        default:
+            return -EINVAL;
+    }
+}
+
+// Пакет операций под одним захватом write_lock. Если в пакете есть
+// изменения, он целиком попадает в одну секцию seq, так что читатели без
+// блокировок видят либо состояние до пакета, либо после.
+static long batch_ioctl(struct pz1_dev *dev, struct pz1_batch __user *ubatch) {
+    struct pz1_batch batch;
+    struct pz1_batch_op *ops;
+    struct pz1_buf *buf;
+    bool modifies = false;
+    size_t ops_size;
+    long ret = 0;
+    u32 i;
+
+    if (copy_from_user(&batch, ubatch, sizeof(batch)))
+        return -EFAULT;
+    if (batch.count == 0)
+        return 0;
+    if (batch.count > PZ1_BATCH_MAX)
+        return -EINVAL;
+
+    ops_size = batch.count * sizeof(*ops);
+    ops = kmalloc(ops_size, GFP_KERNEL);
+    if (!ops)
+        return -ENOMEM;
+    if (copy_from_user(ops, u64_to_user_ptr(batch.ops), ops_size)) {
+        kfree(ops);
         return -EFAULT;
     }
+    for (i = 0; i < batch.count; i++)
+        modifies |= ops[i].op == PZ1_OP_WRITE || ops[i].op == PZ1_OP_RESET;
+
+    mutex_lock(&dev->write_lock);
+    buf = pz1_buf_locked(dev);
+    if (modifies)
+        shared_write_begin(buf);
+    for (i = 0; i < batch.count; i++)
+        ops[i].status = batch_op(dev, buf, &ops[i]);
+    if (modifies)
+        shared_write_end(buf);
+    mutex_unlock(&dev->write_lock);
 
-    *offset += bytes_to_copy;
-    printk(KERN_INFO "pz1_symb_drv: Wrote %d bytes at offset %lld\n", bytes_to_copy, *offset - bytes_to_copy);
-    return bytes_to_copy;
+    if (copy_to_user(u64_to_user_ptr(batch.ops), ops, ops_size))
+        ret = -EFAULT;
+    kfree(ops);
+    return ret;
 }
 
-#define IOCTL_RESET_BUFFER _IOW('k', 1, int)
+static long do_ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
+    struct pz1_dev *dev = file->private_data;
+    struct pz1_buf *buf;
+    int new_size, old_size;
+    int new_mode;
+    bool in_place;
+    int ret = 0;
 
-static long dev_ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
     switch (cmd) {
         case IOCTL_RESET_BUFFER:
-            if (copy_from_user(&buffer_size, (int __user *)arg, sizeof(buffer_size))) {
+            if (copy_from_user(&new_size, (int __user *)arg, sizeof(new_size))) {
                 printk(KERN_ERR "pz1_symb_drv: ioctl copy_from_user failed\n");
                 return -EFAULT;
             }
-            if(buffer_size > BUFFER_SIZE || buffer_size <= 0){
-                printk(KERN_ERR "pz1_symb_drv: Invalid buffer size requested: %d\n", buffer_size);
-                buffer_size = BUFFER_SIZE;
+            new_mode = (new_size & PZ1_RESET_FIFO) ? PZ1_MODE_FIFO : PZ1_MODE_FLAT;
+            new_size &= ~PZ1_RESET_FIFO;
+            if(new_size > max_buffer_size || new_size <= 0 ||
+               (new_mode == PZ1_MODE_FIFO && !is_power_of_2(new_size))){
+                printk(KERN_ERR "pz1_symb_drv: Invalid buffer size requested: %d\n", new_size);
                 return -EINVAL;
             }
-            memset(global_buffer, 0, buffer_size);
-            printk(KERN_INFO "pz1_symb_drv: Buffer reset to size %d\n", buffer_size);
+            buffer_lock_all(dev);
+            // Перевыделяем, только если меняется число страниц
+            old_size = dev->buffer_size;
+            if (SHARED_AREA_SIZE(new_size) != pz1_buf_locked(dev)->area_size) {
+                ret = buffer_realloc(dev, new_size, false);
+                if (ret) {
+                    buffer_unlock_all(dev);
+                    return ret;
+                }
+            }
+            buf = pz1_buf_locked(dev);
+            shared_write_begin(buf);
+            dev->buffer_mode = new_mode;
+            dev->buffer_size = new_size;
+            dev->head = 0;
+            dev->tail = 0;
+            // В той же области очищаем и хвост за новым размером, иначе
+            // старые данные останутся видны через mmap
+            memset(buf->data, 0, min_t(size_t, max(old_size, new_size), buf->hdr->capacity));
+            buf->hdr->size = dev->buffer_size;
+            buf->hdr->mode = dev->buffer_mode;
+            shared_write_end(buf);
+            buffer_unlock_all(dev);
+            printk(KERN_INFO "pz1_symb_drv: Buffer reset to size %d (%s)\n", new_size,
+                   new_mode == PZ1_MODE_FIFO ? "fifo" : "flat");
+            break;
+        case IOCTL_RESIZE_BUFFER:
+            if (copy_from_user(&new_size, (int __user *)arg, sizeof(new_size))) {
+                printk(KERN_ERR "pz1_symb_drv: ioctl copy_from_user failed\n");
+                return -EFAULT;
+            }
+            if (new_size > max_buffer_size || new_size <= 0) {
+                printk(KERN_ERR "pz1_symb_drv: Invalid buffer size requested: %d\n", new_size);
+                return -EINVAL;
+            }
+            buffer_lock_all(dev);
+            if (dev->buffer_mode == PZ1_MODE_FIFO &&
+                (!is_power_of_2(new_size) || dev->head - dev->tail > new_size)) {
+                ret = -EINVAL;
+            } else if (new_size != dev->buffer_size) {
+                // Если число страниц не меняется, размер меняется на месте,
+                // как в IOCTL_RESET_BUFFER, и mmap этому не мешает
+                in_place = SHARED_AREA_SIZE(new_size) == pz1_buf_locked(dev)->area_size;
+                if (!in_place)
+                    ret = buffer_realloc(dev, new_size, true);
+                if (!ret) {
+                    buf = pz1_buf_locked(dev);
+                    shared_write_begin(buf);
+                    if (in_place)
+                        buffer_resize_in_place(dev, buf, new_size);
+                    dev->buffer_size = new_size;
+                    buf->hdr->size = dev->buffer_size;
+                    shared_write_end(buf);
+                }
+            }
+            buffer_unlock_all(dev);
+            if (ret)
+                return ret;
+            printk(KERN_INFO "pz1_symb_drv: Buffer resized to %d bytes\n", new_size);
             break;
+        case IOCTL_BATCH:
+            return batch_ioctl(dev, (struct pz1_batch __user *)arg);
         default:
             printk(KERN_WARNING "pz1_symb_drv: Unknown ioctl command\n");
             return -ENOTTY;
@@ -104,23 +900,192 @@ static long dev_ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
     return 0;
 }
 
+static long dev_ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
+    long ret = do_ioctl(file, cmd, arg);
+
+    this_cpu_inc(pz1_stats.ioctl_calls);
+    if (ret < 0)
+        this_cpu_inc(pz1_stats.errors);
+    trace_pz1_ioctl(iminor(file_inode(file)), cmd, ret);
+    return ret;
+}
+
+static void dev_vma_open(struct vm_area_struct *vma) {
+    struct pz1_dev *dev = vma->vm_private_data;
+
+    atomic_inc(&dev->mmap_count);
+}
+
+static void dev_vma_close(struct vm_area_struct *vma) {
+    struct pz1_dev *dev = vma->vm_private_data;
+
+    atomic_dec(&dev->mmap_count);
+}
+
+static const struct vm_operations_struct dev_vm_ops = {
+    .open = dev_vma_open,
+    .close = dev_vma_close,
+};
+
+// Отображение заголовка и буфера в память процесса только для чтения
+static int dev_mmap(struct file *file, struct vm_area_struct *vma) {
+    struct pz1_dev *dev = file->private_data;
+    unsigned long len = vma->vm_end - vma->vm_start;
+    struct pz1_buf *buf;
+    int ret;
+
+    if (vma->vm_pgoff != 0)
+        return -EINVAL;
+    if (vma->vm_flags & VM_WRITE)
+        return -EPERM;
+    vm_flags_clear(vma, VM_MAYWRITE);
+
+    // Блокировки здесь брать нельзя: mmap вызывается под mmap_lock, а писатели
+    // держат write_lock во время copy_from_user, который может его запросить.
+    // Поэтому сначала учитываем отображение, а после remap проверяем, что
+    // область не успели заменить. buffer_realloc, наоборот, сначала меняет
+    // дескриптор, а потом проверяет счётчик и откатывает замену, так что
+    // хотя бы одна сторона увидит другую (пара к smp_mb() в buffer_realloc).
+    atomic_inc(&dev->mmap_count);
+    smp_mb__after_atomic();
+    buf = pz1_buf_get(dev);
+    if (len > buf->area_size)
+        ret = -EINVAL;
+    else
+        ret = remap_vmalloc_range(vma, buf->area, 0);
+    smp_mb();
+    if (!ret && rcu_access_pointer(dev->buf) != buf)
+        ret = -EAGAIN;
+    pz1_buf_put(buf);
+    if (ret) {
+        atomic_dec(&dev->mmap_count);
+        return ret;
+    }
+
+    vma->vm_ops = &dev_vm_ops;
+    vma->vm_private_data = dev;
+    return 0;
+}
+
+static __poll_t dev_poll(struct file *file, poll_table *wait) {
+    struct pz1_dev *dev = file->private_data;
+    __poll_t mask = 0;
+    unsigned int used;
+
+    poll_wait(file, &dev->read_wq, wait);
+    poll_wait(file, &dev->write_wq, wait);
+
+    // В обычном режиме устройство всегда готово
+    if (READ_ONCE(dev->buffer_mode) != PZ1_MODE_FIFO)
+        return EPOLLIN | EPOLLRDNORM | EPOLLOUT | EPOLLWRNORM;
+
+    used = ring_used(dev);
+    if (used)
+        mask |= EPOLLIN | EPOLLRDNORM;
+    if (used < READ_ONCE(dev->buffer_size))
+        mask |= EPOLLOUT | EPOLLWRNORM;
+    return mask;
+}
+
+// Атрибуты класса со счётчиками, суммированными по всем процессорам
+#define PZ1_STAT_ATTR(field)                                                        \
+static ssize_t field##_show(const struct class *class, const struct class_attribute *attr, \
+                            char *buf) {                                            \
+    u64 sum = 0;                                                                    \
+    int cpu;                                                                        \
+                                                                                    \
+    for_each_possible_cpu(cpu)                                                      \
+        sum += per_cpu(pz1_stats, cpu).field;                                       \
+    return sysfs_emit(buf, "%llu\n", sum);                                          \
+}                                                                                   \
+static CLASS_ATTR_RO(field)
+
+PZ1_STAT_ATTR(read_calls);
+PZ1_STAT_ATTR(read_bytes);
+PZ1_STAT_ATTR(write_calls);
+PZ1_STAT_ATTR(write_bytes);
+PZ1_STAT_ATTR(ioctl_calls);
+PZ1_STAT_ATTR(errors);
+
+static const struct class_attribute *pz1_stats_attrs[] = {
+    &class_attr_read_calls,
+    &class_attr_read_bytes,
+    &class_attr_write_calls,
+    &class_attr_write_bytes,
+    &class_attr_ioctl_calls,
+    &class_attr_errors,
+};
+
+static void pz1_stats_remove(unsigned int count) {
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+        class_remove_file(dev_class, pz1_stats_attrs[i]);
+}
+
+static int pz1_stats_create(void) {
+    unsigned int i;
+    int ret;
+
+    for (i = 0; i < ARRAY_SIZE(pz1_stats_attrs); i++) {
+        ret = class_create_file(dev_class, pz1_stats_attrs[i]);
+        if (ret) {
+            pz1_stats_remove(i);
+            return ret;
+        }
+    }
+    return 0;
+}
+
+// Удаление созданных устройств и буферов миноров [0, count)
+static void pz1_devices_destroy(unsigned int count) {
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+        device_destroy(dev_class, MKDEV(major_number, i));
+        pz1_dev_destroy(devices[i]);
+    }
+}
+
 static int __init pz1_symb_drv_init(void) {
-    // Регистрация устройства
-    major_number = register_chrdev(0, DRIVER_NAME, &fops);
-    if (major_number < 0) {
+    dev_t first;
+    struct device *dev_device;
+    unsigned int i;
+    int ret;
+
+    if (max_buffer_size < BUFFER_SIZE) {
+        printk(KERN_ERR "pz1_symb_drv: max_buffer_size must be at least %d\n", BUFFER_SIZE);
+        return -EINVAL;
+    }
+    if (num_devices == 0 || num_devices > MINORMASK) {
+        printk(KERN_ERR "pz1_symb_drv: Invalid num_devices: %u\n", num_devices);
+        return -EINVAL;
+    }
+
+    devices = kcalloc(num_devices, sizeof(*devices), GFP_KERNEL);
+    if (!devices)
+        return -ENOMEM;
+
+    // Регистрация диапазона миноров
+    ret = alloc_chrdev_region(&first, 0, num_devices, DRIVER_NAME);
+    if (ret < 0) {
         printk(KERN_ERR "pz1_symb_drv: Failed to register a major number\n");
-        return major_number;
+        kfree(devices);
+        return ret;
     }
+    major_number = MAJOR(first);
 
     // Инициализация cdev
     cdev_init(&cdev, &fops);
     cdev.owner = THIS_MODULE;
 
-    // Добавление устройства в систему
-    if (cdev_add(&cdev, MKDEV(major_number, 0), 1) < 0) {
+    // Добавление устройств в систему
+    ret = cdev_add(&cdev, first, num_devices);
+    if (ret < 0) {
         printk(KERN_ERR "pz1_symb_drv: Failed to add cdev\n");
-        unregister_chrdev(major_number, DRIVER_NAME);
-        return -1;
+        unregister_chrdev_region(first, num_devices);
+        kfree(devices);
+        return ret;
     }
 
     // Создание класса устройства
@@ -128,36 +1093,81 @@ static int __init pz1_symb_drv_init(void) {
     if (IS_ERR(dev_class)) {
         printk(KERN_ERR "pz1_symb_drv: Failed to create device class\n");
         cdev_del(&cdev);
-        unregister_chrdev(major_number, DRIVER_NAME);
+        unregister_chrdev_region(first, num_devices);
+        kfree(devices);
         return PTR_ERR(dev_class);
     }
 
-    // Создание устройства
-    dev_device = device_create(dev_class, NULL, MKDEV(major_number, 0), NULL, DRIVER_NAME);
-    if (IS_ERR(dev_device)) {
-        printk(KERN_ERR "pz1_symb_drv: Failed to create device\n");
+    // Счётчики в /sys/class/pz1_symb_drv/
+    ret = pz1_stats_create();
+    if (ret) {
+        printk(KERN_ERR "pz1_symb_drv: Failed to create stats attributes\n");
         class_destroy(dev_class);
         cdev_del(&cdev);
-        unregister_chrdev(major_number, DRIVER_NAME);
-        return PTR_ERR(dev_device);
+        unregister_chrdev_region(first, num_devices);
+        kfree(devices);
+        return ret;
     }
 
-    printk(KERN_INFO "pz1_symb_drv: Module loaded. Major number: %d\n", major_number);
+    // Создание устройств: минор 0 — /dev/pz1_symb_drv, остальные — /dev/pz1_symb_drvN
+    for (i = 0; i < num_devices; i++) {
+        // В режиме private_buffers каждое открытие получает свой буфер,
+        // общий буфер минора не нужен
+        if (!private_buffers) {
+            devices[i] = pz1_dev_create();
+            if (!devices[i]) {
+                printk(KERN_ERR "pz1_symb_drv: Failed to allocate buffer\n");
+                ret = -ENOMEM;
+                goto err_devices;
+            }
+        }
+
+        if (i == 0)
+            dev_device = device_create(dev_class, NULL, first, NULL, DRIVER_NAME);
+        else
+            dev_device = device_create(dev_class, NULL, MKDEV(major_number, i), NULL,
+                                       DRIVER_NAME "%u", i);
+        if (IS_ERR(dev_device)) {
+            printk(KERN_ERR "pz1_symb_drv: Failed to create device\n");
+            ret = PTR_ERR(dev_device);
+            pz1_dev_destroy(devices[i]);
+            goto err_devices;
+        }
+    }
+
+    printk(KERN_INFO "pz1_symb_drv: Module loaded. Major number: %d, devices: %u\n",
+           major_number, num_devices);
     return 0;
+
+err_devices:
+    pz1_devices_destroy(i);
+    pz1_stats_remove(ARRAY_SIZE(pz1_stats_attrs));
+    class_destroy(dev_class);
+    cdev_del(&cdev);
+    unregister_chrdev_region(first, num_devices);
+    kfree(devices);
+    srcu_barrier(&pz1_srcu);
+    return ret;
 }
 
 static void __exit pz1_symb_drv_exit(void) {
-    // Удаление устройства
-    device_destroy(dev_class, MKDEV(major_number, 0));
+    // Удаление устройств и их буферов
+    pz1_devices_destroy(num_devices);
 
-    // Удаление класса устройства
+    // Удаление счётчиков и класса устройства
+    pz1_stats_remove(ARRAY_SIZE(pz1_stats_attrs));
     class_destroy(dev_class);
 
     // Удаление устройства из системы
     cdev_del(&cdev);
 
-    // Отмена регистрации устройства
-    unregister_chrdev(major_number, DRIVER_NAME);
+    // Отмена регистрации миноров
+    unregister_chrdev_region(MKDEV(major_number, 0), num_devices);
+
+    kfree(devices);
+
+    // Дожидаемся освобождения дескрипторов, отложенного через call_srcu
+    srcu_barrier(&pz1_srcu);
 
     printk(KERN_INFO "pz1_symb_drv: Module unloaded\n");
 }
@@ -167,4 +1177,4 @@ module_exit(pz1_symb_drv_exit);
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("kolganovr & mantlern");
-MODULE_DESCRIPTION("PZ1 Symbolic Driver");
\ No newline at end of file
+MODULE_DESCRIPTION("PZ1 Symbolic Driver");
@@ -0,0 +1,97 @@
+#ifndef PZ1_SYMB_DRV_H
+#define PZ1_SYMB_DRV_H
+
+// Общие определения драйвера и пользовательских программ
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define PZ1_DEVICE_PATH "/dev/pz1_symb_drv"
+
+// Аргумент — новый размер буфера. Если установлен флаг PZ1_RESET_FIFO,
+// устройство переключается в режим FIFO с кольцом указанного размера
+// (степень двойки), иначе — в обычный режим плоского массива.
+#define IOCTL_RESET_BUFFER _IOW('k', 1, int)
+#define PZ1_RESET_FIFO 0x40000000
+
+// Изменение размера буфера с сохранением содержимого (в пределах нового
+// размера). Размер ограничен параметром модуля max_buffer_size; в режиме
+// FIFO он должен быть степенью двойки и вмещать непрочитанные данные.
+#define IOCTL_RESIZE_BUFFER _IOW('k', 2, int)
+
+// Режимы работы буфера
+#define PZ1_MODE_FLAT 0
+#define PZ1_MODE_FIFO 1
+
+// Пакет операций, выполняемых за один захват блокировки писателей.
+// Для каждой операции в status возвращается число байт или -errno;
+// ошибка одной операции не прерывает остальные. Чтение, запись и
+// обнуление работают только в обычном режиме.
+#define PZ1_OP_READ  0  // из буфера по offset в ptr, length байт
+#define PZ1_OP_WRITE 1  // из ptr в буфер по offset, length байт
+#define PZ1_OP_RESET 2  // обнулить length байт с offset (0 — до конца буфера)
+#define PZ1_OP_STAT  3  // записать struct pz1_stat в ptr
+
+#define PZ1_BATCH_MAX 256
+
+struct pz1_batch_op {
+    __u32 op;
+    __u32 length;
+    __u64 offset;
+    __u64 ptr;
+    __s32 status;
+    __u32 reserved;
+};
+
+struct pz1_batch {
+    __u64 ops;          // указатель на массив struct pz1_batch_op
+    __u32 count;        // не больше PZ1_BATCH_MAX
+    __u32 reserved;
+};
+
+struct pz1_stat {
+    __u32 size;
+    __u32 mode;
+    __u32 capacity;
+    __u32 used;         // непрочитанные байты кольца в режиме FIFO
+    __u32 seq;
+};
+
+#define IOCTL_BATCH _IOWR('k', 3, struct pz1_batch)
+
+// Заголовок в первой странице mmap-отображения.
+// Данные буфера начинаются со смещения data_offset от начала отображения.
+// seq нечётный, пока драйвер меняет буфер; читатель повторяет копирование,
+// если seq был нечётным или изменился за время чтения.
+struct pz1_shared_hdr {
+    __u32 seq;
+    __u32 size;         // текущий buffer_size
+    __u32 capacity;     // размер области данных
+    __u32 data_offset;
+    __u32 mode;         // PZ1_MODE_*
+};
+
+#ifndef __KERNEL__
+#include <string.h>
+
+// Согласованная копия буфера из mmap-отображения без системных вызовов
+static inline __u32 pz1_mmap_read(const volatile struct pz1_shared_hdr *hdr, const char *data,
+                                  char *dst, __u32 len) {
+    __u32 seq, size, n;
+
+    do {
+        seq = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1)
+            continue;
+        // len не меняем: повтор мог увидеть больший размер
+        size = hdr->size;
+        n = len < size ? len : size;
+        memcpy(dst, data, n);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || __atomic_load_n(&hdr->seq, __ATOMIC_RELAXED) != seq);
+
+    return n;
+}
+#endif
+
+#endif
@@ -0,0 +1,71 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM pz1_symb_drv
+
+#if !defined(_PZ1_SYMB_DRV_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _PZ1_SYMB_DRV_TRACE_H
+
+#include <linux/tracepoint.h>
+
+// Точки трассировки путей ввода-вывода; выключенные почти ничего не стоят.
+// ret — результат вызова: число байт или отрицательный код ошибки.
+DECLARE_EVENT_CLASS(pz1_io,
+    TP_PROTO(unsigned int minor, int mode, loff_t offset, size_t count, ssize_t ret),
+    TP_ARGS(minor, mode, offset, count, ret),
+
+    TP_STRUCT__entry(
+        __field(unsigned int, minor)
+        __field(int, mode)
+        __field(loff_t, offset)
+        __field(size_t, count)
+        __field(ssize_t, ret)
+    ),
+
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->mode = mode;
+        __entry->offset = offset;
+        __entry->count = count;
+        __entry->ret = ret;
+    ),
+
+    TP_printk("minor=%u mode=%s offset=%lld count=%zu ret=%zd",
+              __entry->minor, __entry->mode ? "fifo" : "flat",
+              __entry->offset, __entry->count, __entry->ret)
+);
+
+DEFINE_EVENT(pz1_io, pz1_read,
+    TP_PROTO(unsigned int minor, int mode, loff_t offset, size_t count, ssize_t ret),
+    TP_ARGS(minor, mode, offset, count, ret)
+);
+
+DEFINE_EVENT(pz1_io, pz1_write,
+    TP_PROTO(unsigned int minor, int mode, loff_t offset, size_t count, ssize_t ret),
+    TP_ARGS(minor, mode, offset, count, ret)
+);
+
+TRACE_EVENT(pz1_ioctl,
+    TP_PROTO(unsigned int minor, unsigned int cmd, long ret),
+    TP_ARGS(minor, cmd, ret),
+
+    TP_STRUCT__entry(
+        __field(unsigned int, minor)
+        __field(unsigned int, cmd)
+        __field(long, ret)
+    ),
+
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->cmd = cmd;
+        __entry->ret = ret;
+    ),
+
+    TP_printk("minor=%u cmd=0x%x ret=%ld", __entry->minor, __entry->cmd, __entry->ret)
+);
+
+#endif
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE pz1_symb_drv_trace
+#include <trace/define_trace.h>
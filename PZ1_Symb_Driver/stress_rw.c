@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "pz1_symb_drv.h"
+
+// Нагрузочный тест: один писатель заполняет весь буфер одним байтом,
+// читатели проверяют, что прочитанный буфер однороден (не разорван),
+// и считают пропускную способность при разном числе потоков.
+
+static volatile int stop;
+static int buffer_len;
+
+struct reader_stats {
+    long reads;
+    long torn;
+    long errors;
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *writer_thread(void *arg) {
+    char *buf = malloc(buffer_len);
+    unsigned char value = 0;
+    int fd = open(PZ1_DEVICE_PATH, O_WRONLY);
+
+    (void)arg;
+    if (fd < 0 || !buf) {
+        perror("writer");
+        exit(1);
+    }
+    while (!stop) {
+        memset(buf, 'A' + value++ % 26, buffer_len);
+        if (pwrite(fd, buf, buffer_len, 0) != buffer_len) {
+            perror("pwrite");
+            exit(1);
+        }
+    }
+    close(fd);
+    free(buf);
+    return NULL;
+}
+
+static void *reader_thread(void *arg) {
+    struct reader_stats *stats = arg;
+    char *buf = malloc(buffer_len);
+    int fd = open(PZ1_DEVICE_PATH, O_RDONLY);
+
+    if (fd < 0 || !buf) {
+        perror("reader");
+        exit(1);
+    }
+    while (!stop) {
+        ssize_t n = pread(fd, buf, buffer_len, 0);
+        if (n != buffer_len) {
+            stats->errors++;
+            continue;
+        }
+        for (int i = 1; i < buffer_len; i++) {
+            if (buf[i] != buf[0]) {
+                stats->torn++;
+                break;
+            }
+        }
+        stats->reads++;
+    }
+    close(fd);
+    free(buf);
+    return NULL;
+}
+
+// Один прогон с заданным числом читателей; возвращает число разорванных чтений
+static long run(int readers, double duration) {
+    pthread_t writer, threads[readers];
+    struct reader_stats stats[readers];
+    long reads = 0, torn = 0, errors = 0;
+
+    memset(stats, 0, sizeof(stats));
+    stop = 0;
+    pthread_create(&writer, NULL, writer_thread, NULL);
+    for (int i = 0; i < readers; i++)
+        pthread_create(&threads[i], NULL, reader_thread, &stats[i]);
+
+    double start = now_sec();
+    usleep(duration * 1e6);
+    stop = 1;
+    for (int i = 0; i < readers; i++) {
+        pthread_join(threads[i], NULL);
+        reads += stats[i].reads;
+        torn += stats[i].torn;
+        errors += stats[i].errors;
+    }
+    pthread_join(writer, NULL);
+    double elapsed = now_sec() - start;
+
+    printf("%7d %12ld %14.0f %10ld %8ld\n", readers, reads, reads / elapsed, torn, errors);
+    return torn + errors;
+}
+
+int main(int argc, char *argv[]) {
+    int max_readers = argc > 1 ? atoi(argv[1]) : 16;
+    double duration = argc > 2 ? atof(argv[2]) : 2.0;
+    long failures = 0;
+
+    int fd = open(PZ1_DEVICE_PATH, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open device");
+        return 1;
+    }
+    buffer_len = 1024;
+    if (ioctl(fd, IOCTL_RESET_BUFFER, &buffer_len) < 0) {
+        fprintf(stderr, "ioctl failed: %s\n", strerror(errno));
+        close(fd);
+        return 1;
+    }
+    close(fd);
+
+    printf("readers        reads        reads/s       torn   errors\n");
+    for (int readers = 1; readers <= max_readers; readers *= 2)
+        failures += run(readers, duration);
+
+    if (failures) {
+        printf("FAILED: %ld inconsistent reads\n", failures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
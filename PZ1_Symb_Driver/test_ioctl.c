@@ -1,27 +1,132 @@
 #include <stdio.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 
-#define IOCTL_RESET_BUFFER _IOW('k', 1, int)
+#include "pz1_symb_drv.h"
 
-int main() {
-    int fd = open("/dev/pz1_symb_drv", O_RDWR);
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Демонстрация и сравнение пакетного ioctl с отдельными вызовами:
+// за итерацию ops мелких записей по разным смещениям, затем столько же чтений
+static int batch_demo(int fd, int ops, long iterations) {
+    struct pz1_batch_op batch_ops[PZ1_BATCH_MAX];
+    struct pz1_batch batch;
+    struct pz1_stat stat;
+    char data[PZ1_BATCH_MAX][8];
+    int field = sizeof(data[0]);
+
+    if (ops < 1 || ops * 2 + 1 > PZ1_BATCH_MAX) {
+        fprintf(stderr, "ops must be between 1 and %d\n", (PZ1_BATCH_MAX - 1) / 2);
+        return 1;
+    }
+
+    // Один пакет: записи, чтения и запрос состояния
+    for (int i = 0; i < ops; i++) {
+        snprintf(data[i], field, "f%06d", i);
+        batch_ops[i] = (struct pz1_batch_op){
+            .op = PZ1_OP_WRITE, .length = field, .offset = i * field, .ptr = (__u64)(unsigned long)data[i],
+        };
+        batch_ops[ops + i] = (struct pz1_batch_op){
+            .op = PZ1_OP_READ, .length = field, .offset = i * field,
+            .ptr = (__u64)(unsigned long)data[ops + i],
+        };
+    }
+    batch_ops[2 * ops] = (struct pz1_batch_op){
+        .op = PZ1_OP_STAT, .length = sizeof(stat), .ptr = (__u64)(unsigned long)&stat,
+    };
+    batch.ops = (__u64)(unsigned long)batch_ops;
+    batch.count = 2 * ops + 1;
+
+    if (ioctl(fd, IOCTL_BATCH, &batch) < 0) {
+        fprintf(stderr, "ioctl failed: %s\n", strerror(errno));
+        return 1;
+    }
+    for (unsigned i = 0; i < batch.count; i++) {
+        if (batch_ops[i].status < 0) {
+            fprintf(stderr, "op %u failed: %s\n", i, strerror(-batch_ops[i].status));
+            return 1;
+        }
+    }
+    printf("Batch of %u ops: buffer size %u, mode %u, seq %u, first field \"%.*s\"\n", batch.count,
+           stat.size, stat.mode, stat.seq, field, data[ops]);
+
+    double start = now_sec();
+    for (long it = 0; it < iterations; it++) {
+        for (int i = 0; i < ops; i++) {
+            if (pwrite(fd, data[i], field, i * field) != field) {
+                perror("pwrite");
+                return 1;
+            }
+        }
+        for (int i = 0; i < ops; i++) {
+            if (pread(fd, data[ops + i], field, i * field) != field) {
+                perror("pread");
+                return 1;
+            }
+        }
+    }
+    double single = now_sec() - start;
+
+    batch.count = 2 * ops;
+    start = now_sec();
+    for (long it = 0; it < iterations; it++) {
+        if (ioctl(fd, IOCTL_BATCH, &batch) < 0) {
+            fprintf(stderr, "ioctl failed: %s\n", strerror(errno));
+            return 1;
+        }
+    }
+    double batched = now_sec() - start;
+
+    printf("one-by-one: %9.1f ns/iter  %4d syscalls/iter\n", single * 1e9 / iterations, 2 * ops);
+    printf("batched:    %9.1f ns/iter  %4d syscalls/iter\n", batched * 1e9 / iterations, 1);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int fd = open(PZ1_DEVICE_PATH, O_RDWR);
     if (fd < 0) {
         perror("Failed to open device");
         return 1;
     }
 
-    int new_size = 512;
-    if (ioctl(fd, IOCTL_RESET_BUFFER, &new_size) < 0) {
+    if (argc > 1 && strcmp(argv[1], "batch") == 0) {
+        int ret = batch_demo(fd, argc > 2 ? atoi(argv[2]) : 16, argc > 3 ? atol(argv[3]) : 100000);
+        close(fd);
+        return ret;
+    }
+
+    int new_size = argc > 1 ? atoi(argv[1]) : 512;
+    int fifo = argc > 2 && strcmp(argv[2], "fifo") == 0;
+    int resize = argc > 2 && strcmp(argv[2], "resize") == 0;
+
+    if (resize) {
+        if (ioctl(fd, IOCTL_RESIZE_BUFFER, &new_size) < 0) {
+            fprintf(stderr, "ioctl failed: %s\n", strerror(errno));
+            close(fd);
+            return 1;
+        }
+        printf("Buffer resized to %d bytes\n", new_size);
+        close(fd);
+        return 0;
+    }
+
+    int arg = new_size | (fifo ? PZ1_RESET_FIFO : 0);
+    if (ioctl(fd, IOCTL_RESET_BUFFER, &arg) < 0) {
         fprintf(stderr, "ioctl failed: %s\n", strerror(errno));
         close(fd);
         return 1;
     }
 
-    printf("Buffer reset to size %d\n", new_size);
+    printf("Buffer reset to size %d (%s)\n", new_size, fifo ? "fifo" : "flat");
     close(fd);
     return 0;
 }
\ No newline at end of file
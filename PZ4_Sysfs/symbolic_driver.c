@@ -2,77 +2,902 @@
 #include <linux/kernel.h>
 #include <linux/kobject.h>
 #include <linux/sysfs.h>
-#include <linux/timer.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/atomic.h>
+#include <linux/percpu_counter.h>
+#include <linux/seqlock.h>
+#include <linux/timekeeping.h>
+#include <linux/timerqueue.h>
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
+#include <linux/smp.h>
+#include <linux/slab.h>
+#include <linux/list.h>
+#include <linux/ctype.h>
 #include <linux/string.h>
 #include <linux/init.h>
 
-static int global_variable = 0;
-static struct timer_list my_timer;
+#include "symbolic_driver.h"
+
+#define CREATE_TRACE_POINTS
+#include "symbolic_driver_trace.h"
+
+// Shorter periods make the callback alone saturate a CPU
+#define PERIOD_MIN_NS (10 * NSEC_PER_USEC)
+
+// Backends of global_variable: one atomic64_t, or a percpu_counter that keeps
+// per-CPU deltas and folds them into the total in batches. The per-CPU one
+// scales when many CPUs bump the counter at a high rate.
+static bool percpu_mode;
+module_param(percpu_mode, bool, 0444);
+MODULE_PARM_DESC(percpu_mode, "Back global_variable with a per-CPU counter (fast reads are approximate)");
+
+static atomic64_t global_atomic = ATOMIC64_INIT(0);
+static struct percpu_counter global_percpu;
+static struct hrtimer my_timer;
+static u64 period_ns = NSEC_PER_SEC;    // Timer period, 1 second by default
+static unsigned long overruns;          // Periods missed because the callback ran late
 static struct kobject *my_kobject;
 static bool timer_running = false;
+static DEFINE_MUTEX(timer_lock);        // Serializes state updates
+
+// Change notification: poll() on global_variable wakes up on every
+// notify_every-th timer tick or, if notify_threshold is set, once the value
+// has moved by at least that much since the last notification. A write to
+// global_variable always notifies. sysfs_notify() may sleep, so the node is
+// looked up once at init and notified with sysfs_notify_dirent(), which is
+// safe in the timer callback.
+static unsigned int notify_every = 1;   // 0 with no threshold: writes only
+static u64 notify_threshold;
+static struct kernfs_node *global_variable_kn;
+static unsigned int notify_pending;     // Ticks since the last notification
+static s64 notify_value;                // Value at the last notification
+static u64 notify_seq;                  // Number of notifications
+static u64 notify_ns;                   // CLOCK_MONOTONIC time of the last one
+
+static u64 ticks;                       // Timer callbacks since load
+static u64 last_tick_ns;                // CLOCK_MONOTONIC time of the last one
+
+// Tick instrumentation of the main timer, since load or the last reset.
+// Lateness is the expiry time minus the deadline; bucket i of the histogram
+// holds lateness in [2^(i-1), 2^i) ns, bucket 0 zero lateness and the last
+// one everything above. Duration covers the callback up to its unlock.
+#define LATENESS_BUCKETS 32
+
+struct tick_stats {
+    u64 count;
+    u64 lateness_sum;
+    u64 lateness_max;
+    u64 duration_sum;
+    u64 duration_max;
+    u64 lateness_hist[LATENESS_BUCKETS];
+};
 
-static void timer_callback(struct timer_list *t)
+static struct tick_stats tick_stats;
+
+// Every change of the state above, of the value from the timer or sysfs,
+// of the period and of timer_running happens under state_lock, so the
+// binary snapshot is consistent. Readers retry instead of blocking the timer.
+static DEFINE_SEQLOCK(state_lock);
+
+// Called with state_lock held; returns true if pollers should be woken
+static bool notify_check(s64 value, bool force)
 {
-    global_variable++;
-    printk(KERN_INFO "Symbolic Driver: global_variable incremented to %d\n", global_variable);
-    mod_timer(&my_timer, jiffies + HZ); // Re-arm the timer for 1 second later
+    bool notify;
+
+    if (force)
+        notify = true;
+    else if (notify_threshold)
+        notify = (u64)abs(value - notify_value) >= notify_threshold;
+    else
+        notify = notify_every && ++notify_pending >= notify_every;
+    if (notify) {
+        notify_pending = 0;
+        notify_value = value;
+        notify_seq++;
+        notify_ns = ktime_get_ns();
+    }
+    return notify;
 }
 
+static void notify_pollers(void)
+{
+    if (global_variable_kn)
+        sysfs_notify_dirent(global_variable_kn);
+}
+
+// Called with state_lock held
+static void tick_stats_add(u64 lateness_ns, u64 duration_ns)
+{
+    unsigned int bucket = min_t(unsigned int, fls64(lateness_ns), LATENESS_BUCKETS - 1);
+
+    tick_stats.count++;
+    tick_stats.lateness_sum += lateness_ns;
+    tick_stats.lateness_max = max(tick_stats.lateness_max, lateness_ns);
+    tick_stats.duration_sum += duration_ns;
+    tick_stats.duration_max = max(tick_stats.duration_max, duration_ns);
+    tick_stats.lateness_hist[bucket]++;
+}
+
+static enum hrtimer_restart timer_callback(struct hrtimer *t)
+{
+    ktime_t now = hrtimer_cb_get_time(t);
+    u64 lateness_ns = max_t(s64, ktime_sub(now, hrtimer_get_expires(t)), 0);
+    u64 missed, duration_ns;
+    unsigned long flags;
+    bool notify;
+    s64 value;
+
+    write_seqlock_irqsave(&state_lock, flags);
+    symbolic_driver_counter_inc();
+    value = symbolic_driver_counter_read(false);
+    ticks++;
+    last_tick_ns = ktime_to_ns(now);
+    notify = notify_check(value, false);
+
+    // Re-arm from the previous deadline rather than from now, so the period
+    // does not drift. If the callback ran more than a period late, the
+    // skipped deadlines are counted as overruns instead of fired late.
+    missed = hrtimer_forward(t, now, ns_to_ktime(period_ns));
+    missed = missed > 1 ? missed - 1 : 0;
+    WRITE_ONCE(overruns, overruns + missed);
+
+    duration_ns = ktime_get_ns() - ktime_to_ns(now);
+    tick_stats_add(lateness_ns, duration_ns);
+    write_sequnlock_irqrestore(&state_lock, flags);
+
+    // Outside the write section, so readers do not retry on kernfs work
+    if (notify)
+        notify_pollers();
+
+    trace_symbolic_tick(value, lateness_ns, duration_ns, missed);
+    return HRTIMER_RESTART;
+}
+
+void symbolic_driver_counter_add(s64 delta)
+{
+    if (percpu_mode)
+        percpu_counter_add(&global_percpu, delta);
+    else
+        atomic64_add(delta, &global_atomic);
+}
+EXPORT_SYMBOL_GPL(symbolic_driver_counter_add);
+
+s64 symbolic_driver_counter_read(bool exact)
+{
+    if (!percpu_mode)
+        return atomic64_read(&global_atomic);
+    return exact ? percpu_counter_sum(&global_percpu) : percpu_counter_read(&global_percpu);
+}
+EXPORT_SYMBOL_GPL(symbolic_driver_counter_read);
+
+// Consistent copy of the whole state
+static void state_snapshot(struct symbolic_driver_state *st)
+{
+    unsigned int seq;
+
+    do {
+        seq = read_seqbegin(&state_lock);
+        memset(st, 0, sizeof(*st));
+        st->version = SYMBOLIC_STATE_VERSION;
+        st->size = sizeof(*st);
+        st->value = symbolic_driver_counter_read(true);
+        st->flags = timer_running ? SYMBOLIC_STATE_RUNNING : 0;
+        st->notify_every = notify_every;
+        st->period_ns = period_ns;
+        st->ticks = ticks;
+        st->last_tick_ns = last_tick_ns;
+        st->overruns = overruns;
+        st->notify_seq = notify_seq;
+        st->notify_ns = notify_ns;
+        st->notify_threshold = notify_threshold;
+    } while (read_seqretry(&state_lock, seq));
+}
+
+// Applies all fields selected in u->mask at once, as seen by state_snapshot().
+// Every sysfs store goes through here. Nothing is changed if a field is invalid.
+static int state_update(const struct symbolic_driver_update *u)
+{
+    bool start, stop, notify = false;
+    unsigned long flags;
+
+    if (u->version != SYMBOLIC_STATE_VERSION || (u->mask & ~SYMBOLIC_SET_ALL))
+        return -EINVAL;
+    if ((u->mask & SYMBOLIC_SET_PERIOD) &&
+        (u->period_ns < PERIOD_MIN_NS || u->period_ns > KTIME_MAX))
+        return -EINVAL;
+
+    mutex_lock(&timer_lock);
+    start = (u->mask & SYMBOLIC_SET_RUNNING) && u->running && !timer_running;
+    stop = (u->mask & SYMBOLIC_SET_RUNNING) && !u->running && timer_running;
+    // The callback takes state_lock, so cancel before taking it
+    if (stop)
+        hrtimer_cancel(&my_timer);
+
+    write_seqlock_irqsave(&state_lock, flags);
+    // Overwrites the value; increments racing with the write may be lost
+    if (u->mask & SYMBOLIC_SET_VALUE) {
+        if (percpu_mode)
+            percpu_counter_set(&global_percpu, u->value);
+        else
+            atomic64_set(&global_atomic, u->value);
+        notify = notify_check(u->value, true);
+    }
+    if (u->mask & SYMBOLIC_SET_PERIOD)
+        WRITE_ONCE(period_ns, u->period_ns);
+    if (u->mask & SYMBOLIC_SET_NOTIFY_EVERY)
+        WRITE_ONCE(notify_every, u->notify_every);
+    if (u->mask & SYMBOLIC_SET_NOTIFY_THRESHOLD)
+        WRITE_ONCE(notify_threshold, u->notify_threshold);
+    if (start || stop)
+        WRITE_ONCE(timer_running, start);
+    write_sequnlock_irqrestore(&state_lock, flags);
+
+    // First tick one period from now
+    if (start)
+        hrtimer_start(&my_timer, ns_to_ktime(period_ns), HRTIMER_MODE_REL);
+    mutex_unlock(&timer_lock);
+
+    if (notify)
+        notify_pollers();
+    if (start || stop) {
+        printk(KERN_INFO "Symbolic Driver: Timer %s\n", start ? "started" : "stopped");
+        sysfs_notify(my_kobject, NULL, "timer_start_stop");
+    }
+    return 0;
+}
+
+// Exact value
 static ssize_t global_variable_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
 {
-    return sprintf(buf, "%d\n", global_variable);
+    return sprintf(buf, "%lld\n", symbolic_driver_counter_read(true));
 }
 
 static ssize_t global_variable_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
 {
-    int value;
-    if (sscanf(buf, "%d", &value) == 1) {
-        global_variable = value;
-        return count;
-    } else {
+    struct symbolic_driver_update u = { .version = SYMBOLIC_STATE_VERSION, .mask = SYMBOLIC_SET_VALUE };
+
+    if (kstrtos64(buf, 10, &u.value))
         return -EINVAL;
-    }
+    return state_update(&u) ?: count;
+}
+
+// Approximate value without folding the CPUs together
+static ssize_t global_variable_fast_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%lld\n", symbolic_driver_counter_read(false));
 }
 
 static ssize_t timer_start_stop_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
 {
-    return sprintf(buf, "%s\n", timer_running ? "running" : "stopped");
+    return sprintf(buf, "%s\n", READ_ONCE(timer_running) ? "running" : "stopped");
+}
+
+static ssize_t timer_start_stop_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    struct symbolic_driver_update u = { .version = SYMBOLIC_STATE_VERSION, .mask = SYMBOLIC_SET_RUNNING };
+
+    if (strncmp(buf, "start", 5) == 0)
+        u.running = 1;
+    else if (strncmp(buf, "stop", 4) != 0)
+        return -EINVAL;
+    return state_update(&u) ?: count;
+}
+
+// Timer period in microseconds; a running timer picks it up from the next deadline
+static ssize_t period_us_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%llu\n", div_u64(READ_ONCE(period_ns), NSEC_PER_USEC));
+}
+
+static ssize_t period_us_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    struct symbolic_driver_update u = { .version = SYMBOLIC_STATE_VERSION, .mask = SYMBOLIC_SET_PERIOD };
+    u64 value;
+
+    if (kstrtoull(buf, 10, &value) || value > div_u64(U64_MAX, NSEC_PER_USEC))
+        return -EINVAL;
+    u.period_ns = value * NSEC_PER_USEC;
+    return state_update(&u) ?: count;
 }
 
-    static ssize_t timer_start_stop_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+static ssize_t overruns_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
 {
-    if (strncmp(buf, "start", 5) == 0) {
-            if (!timer_running) {
-                timer_running = true;
-                mod_timer(&my_timer, jiffies + HZ); // Start timer in 1 second
-                printk(KERN_INFO "Symbolic Driver: Timer started\n");
-            }
-    } else if (strncmp(buf, "stop", 4) == 0) {
-        if (timer_running) {
-            del_timer(&my_timer);
-            timer_running = false;
-            printk(KERN_INFO "Symbolic Driver: Timer stopped\n");
+    return sprintf(buf, "%lu\n", READ_ONCE(overruns));
+}
+
+static ssize_t notify_every_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%u\n", READ_ONCE(notify_every));
+}
+
+static ssize_t notify_every_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    struct symbolic_driver_update u = { .version = SYMBOLIC_STATE_VERSION, .mask = SYMBOLIC_SET_NOTIFY_EVERY };
+
+    if (kstrtouint(buf, 10, &u.notify_every))
+        return -EINVAL;
+    return state_update(&u) ?: count;
+}
+
+static ssize_t notify_threshold_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%llu\n", READ_ONCE(notify_threshold));
+}
+
+static ssize_t notify_threshold_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    struct symbolic_driver_update u = { .version = SYMBOLIC_STATE_VERSION, .mask = SYMBOLIC_SET_NOTIFY_THRESHOLD };
+
+    if (kstrtou64(buf, 10, &u.notify_threshold))
+        return -EINVAL;
+    return state_update(&u) ?: count;
+}
+
+// "<seq> <timestamp_ns>" of the last notification, read together so that a
+// watcher can measure its wakeup latency and count missed notifications
+static ssize_t last_notify_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    unsigned int lock_seq;
+    u64 seq, ns;
+
+    do {
+        lock_seq = read_seqbegin(&state_lock);
+        seq = notify_seq;
+        ns = notify_ns;
+    } while (read_seqretry(&state_lock, lock_seq));
+    return sprintf(buf, "%llu %llu\n", seq, ns);
+}
+
+// Define the attributes for global_variable, timer_start_stop, period_us, overruns and notification
+static struct kobj_attribute global_variable_attribute = __ATTR(global_variable, 0664, global_variable_show, global_variable_store);
+static struct kobj_attribute global_variable_fast_attribute = __ATTR_RO(global_variable_fast);
+static struct kobj_attribute timer_start_stop_attribute = __ATTR(timer_start_stop, 0664, timer_start_stop_show, timer_start_stop_store);
+static struct kobj_attribute period_us_attribute = __ATTR(period_us, 0664, period_us_show, period_us_store);
+static struct kobj_attribute overruns_attribute = __ATTR_RO(overruns);
+static struct kobj_attribute notify_every_attribute = __ATTR(notify_every, 0664, notify_every_show, notify_every_store);
+static struct kobj_attribute notify_threshold_attribute = __ATTR(notify_threshold, 0664, notify_threshold_show, notify_threshold_store);
+static struct kobj_attribute last_notify_attribute = __ATTR_RO(last_notify);
+
+// Binary state: one read returns a consistent struct symbolic_driver_state,
+// one write of struct symbolic_driver_update applies several fields at once
+static ssize_t state_read(struct file *file, struct kobject *kobj, struct bin_attribute *attr,
+                          char *buf, loff_t off, size_t count)
+{
+    struct symbolic_driver_state st;
+
+    state_snapshot(&st);
+    return memory_read_from_buffer(buf, count, &off, &st, sizeof(st));
+}
+
+static ssize_t state_write(struct file *file, struct kobject *kobj, struct bin_attribute *attr,
+                           char *buf, loff_t off, size_t count)
+{
+    struct symbolic_driver_update u;
+    int error;
+
+    if (off != 0 || count != sizeof(u))
+        return -EINVAL;
+    memcpy(&u, buf, sizeof(u));
+    error = state_update(&u);
+    return error ?: count;
+}
+
+static BIN_ATTR_RW(state, sizeof(struct symbolic_driver_state));
+
+static struct bin_attribute *bin_attrs[] = {
+    &bin_attr_state,
+    NULL,
+};
+
+// Named instances: /sys/kernel/symbolic_driver/<name>/, created by writing
+// the name to "create" and removed by writing it to "destroy". Each has its
+// own counter, period, CPU and start/stop. Instances do not get a timer of
+// their own: every CPU has one hrtimer and a timerqueue (rbtree) of the
+// deadlines of the instances assigned to it. The hrtimer is armed for the
+// earliest deadline, so a tick costs O(log n) and idle instances cost
+// nothing.
+#define INSTANCE_NAME_LEN 32
+
+struct timer_wheel {
+    raw_spinlock_t lock;            // Protects queue; taken in the callback
+    struct timerqueue_head queue;
+    struct hrtimer timer;           // Pinned to the CPU of this wheel
+};
+
+static DEFINE_PER_CPU(struct timer_wheel, timer_wheels);
+
+struct symbolic_instance {
+    struct kobject kobj;
+    struct list_head list;
+    char name[INSTANCE_NAME_LEN];
+    atomic64_t value;
+    struct timerqueue_node node;    // Next deadline, queued while running
+    u64 period_ns;
+    u64 ticks;
+    u64 overruns;
+    unsigned int cpu;
+    bool running;
+    bool dead;                      // Destroyed, attributes are going away
+};
+
+// Protects the instance list and the configuration of every instance
+static DEFINE_MUTEX(instances_lock);
+static LIST_HEAD(instances);
+
+static enum hrtimer_restart timer_wheel_callback(struct hrtimer *t)
+{
+    struct timer_wheel *wheel = container_of(t, struct timer_wheel, timer);
+    ktime_t now = hrtimer_cb_get_time(t);
+    struct timerqueue_node *next;
+    enum hrtimer_restart ret = HRTIMER_NORESTART;
+
+    raw_spin_lock(&wheel->lock);
+    while ((next = timerqueue_getnext(&wheel->queue)) && next->expires <= now) {
+        struct symbolic_instance *inst = container_of(next, struct symbolic_instance, node);
+        u64 period = READ_ONCE(inst->period_ns);
+
+        timerqueue_del(&wheel->queue, next);
+        trace_symbolic_instance_tick(inst->name, atomic64_inc_return(&inst->value),
+                                     ktime_sub(now, next->expires));
+        WRITE_ONCE(inst->ticks, inst->ticks + 1);
+
+        // Next deadline from the previous one, as for the main timer;
+        // deadlines already in the past are counted as overruns
+        next->expires = ktime_add_ns(next->expires, period);
+        if (next->expires <= now) {
+            u64 missed = div64_u64(now - next->expires, period) + 1;
+
+            WRITE_ONCE(inst->overruns, inst->overruns + missed);
+            next->expires = ktime_add_ns(next->expires, missed * period);
         }
-    } else {
+        timerqueue_add(&wheel->queue, next);
+    }
+    if (next) {
+        hrtimer_set_expires(t, next->expires);
+        ret = HRTIMER_RESTART;
+    }
+    raw_spin_unlock(&wheel->lock);
+    return ret;
+}
+
+// Arms the wheel for its earliest deadline; runs on the CPU of the wheel
+static void timer_wheel_rearm(void *arg)
+{
+    struct timer_wheel *wheel = arg;
+    struct timerqueue_node *next;
+    unsigned long flags;
+
+    raw_spin_lock_irqsave(&wheel->lock, flags);
+    next = timerqueue_getnext(&wheel->queue);
+    if (next)
+        hrtimer_start(&wheel->timer, next->expires, HRTIMER_MODE_ABS_PINNED_HARD);
+    raw_spin_unlock_irqrestore(&wheel->lock, flags);
+}
+
+// Called with instances_lock held
+static void instance_start(struct symbolic_instance *inst)
+{
+    struct timer_wheel *wheel = per_cpu_ptr(&timer_wheels, inst->cpu);
+    unsigned long flags;
+    bool first;
+
+    raw_spin_lock_irqsave(&wheel->lock, flags);
+    inst->node.expires = ktime_add_ns(ktime_get(), inst->period_ns);
+    first = timerqueue_add(&wheel->queue, &inst->node);
+    raw_spin_unlock_irqrestore(&wheel->lock, flags);
+    inst->running = true;
+
+    // Only a new earliest deadline needs the hrtimer moved. If the CPU went
+    // offline meanwhile, arm it here; it stays correct, just not pinned.
+    if (first && smp_call_function_single(inst->cpu, timer_wheel_rearm, wheel, 1))
+        timer_wheel_rearm(wheel);
+}
+
+// Called with instances_lock held. The wheel hrtimer is left armed: if it
+// fires with nothing due it simply re-arms for the next deadline or stops.
+static void instance_stop(struct symbolic_instance *inst)
+{
+    struct timer_wheel *wheel = per_cpu_ptr(&timer_wheels, inst->cpu);
+    unsigned long flags;
+
+    raw_spin_lock_irqsave(&wheel->lock, flags);
+    timerqueue_del(&wheel->queue, &inst->node);
+    raw_spin_unlock_irqrestore(&wheel->lock, flags);
+    inst->running = false;
+}
+
+static struct symbolic_instance *to_instance(struct kobject *kobj)
+{
+    return container_of(kobj, struct symbolic_instance, kobj);
+}
+
+static ssize_t instance_value_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%lld\n", (long long)atomic64_read(&to_instance(kobj)->value));
+}
+
+static ssize_t instance_value_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    s64 value;
+
+    if (kstrtos64(buf, 10, &value))
+        return -EINVAL;
+    atomic64_set(&to_instance(kobj)->value, value);
+    return count;
+}
+
+static ssize_t instance_timer_start_stop_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%s\n", READ_ONCE(to_instance(kobj)->running) ? "running" : "stopped");
+}
+
+static ssize_t instance_timer_start_stop_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    struct symbolic_instance *inst = to_instance(kobj);
+    bool start;
+    int error = 0;
+
+    if (strncmp(buf, "start", 5) == 0)
+        start = true;
+    else if (strncmp(buf, "stop", 4) == 0)
+        start = false;
+    else
+        return -EINVAL;
+
+    mutex_lock(&instances_lock);
+    if (inst->dead)
+        error = -ENODEV;
+    else if (start && !inst->running && !cpu_online(inst->cpu))
+        error = -EINVAL;
+    else if (start && !inst->running)
+        instance_start(inst);
+    else if (!start && inst->running)
+        instance_stop(inst);
+    mutex_unlock(&instances_lock);
+    return error ?: count;
+}
+
+static ssize_t instance_period_us_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%llu\n", div_u64(READ_ONCE(to_instance(kobj)->period_ns), NSEC_PER_USEC));
+}
+
+// Takes effect from the next deadline
+static ssize_t instance_period_us_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    u64 value;
+
+    if (kstrtoull(buf, 10, &value) || value > div_u64(KTIME_MAX, NSEC_PER_USEC) ||
+        value * NSEC_PER_USEC < PERIOD_MIN_NS)
+        return -EINVAL;
+    WRITE_ONCE(to_instance(kobj)->period_ns, value * NSEC_PER_USEC);
+    return count;
+}
+
+static ssize_t instance_cpu_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%u\n", READ_ONCE(to_instance(kobj)->cpu));
+}
+
+// Moves a running instance to the wheel of the new CPU
+static ssize_t instance_cpu_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    struct symbolic_instance *inst = to_instance(kobj);
+    unsigned int cpu;
+    int error = 0;
+
+    if (kstrtouint(buf, 10, &cpu) || cpu >= nr_cpu_ids || !cpu_online(cpu))
+        return -EINVAL;
+
+    mutex_lock(&instances_lock);
+    if (inst->dead) {
+        error = -ENODEV;
+    } else if (cpu != inst->cpu) {
+        bool running = inst->running;
+
+        if (running)
+            instance_stop(inst);
+        WRITE_ONCE(inst->cpu, cpu);
+        if (running)
+            instance_start(inst);
+    }
+    mutex_unlock(&instances_lock);
+    return error ?: count;
+}
+
+static ssize_t instance_ticks_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%llu\n", READ_ONCE(to_instance(kobj)->ticks));
+}
+
+static ssize_t instance_overruns_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%llu\n", READ_ONCE(to_instance(kobj)->overruns));
+}
+
+// The files of an instance are named as those of the main counter
+static struct kobj_attribute instance_value_attribute = __ATTR(value, 0664, instance_value_show, instance_value_store);
+static struct kobj_attribute instance_timer_start_stop_attribute = __ATTR(timer_start_stop, 0664, instance_timer_start_stop_show, instance_timer_start_stop_store);
+static struct kobj_attribute instance_period_us_attribute = __ATTR(period_us, 0664, instance_period_us_show, instance_period_us_store);
+static struct kobj_attribute instance_cpu_attribute = __ATTR(cpu, 0664, instance_cpu_show, instance_cpu_store);
+static struct kobj_attribute instance_ticks_attribute = __ATTR(ticks, 0444, instance_ticks_show, NULL);
+static struct kobj_attribute instance_overruns_attribute = __ATTR(overruns, 0444, instance_overruns_show, NULL);
+
+static struct attribute *instance_attrs[] = {
+    &instance_value_attribute.attr,
+    &instance_timer_start_stop_attribute.attr,
+    &instance_period_us_attribute.attr,
+    &instance_cpu_attribute.attr,
+    &instance_ticks_attribute.attr,
+    &instance_overruns_attribute.attr,
+    NULL,
+};
+ATTRIBUTE_GROUPS(instance);
+
+static void instance_release(struct kobject *kobj)
+{
+    kfree(to_instance(kobj));
+}
+
+static const struct kobj_type instance_ktype = {
+    .release = instance_release,
+    .sysfs_ops = &kobj_sysfs_ops,
+    .default_groups = instance_groups,
+};
+
+// Instance name from a write: letters, digits, '_' and '-'
+static int instance_name_parse(const char *buf, char *name)
+{
+    size_t len = strcspn(buf, "\n");
+    size_t i;
+
+    if (len == 0 || len >= INSTANCE_NAME_LEN)
         return -EINVAL;
+    for (i = 0; i < len; i++) {
+        if (!isalnum(buf[i]) && buf[i] != '_' && buf[i] != '-')
+            return -EINVAL;
+    }
+    memcpy(name, buf, len);
+    name[len] = '\0';
+    return 0;
+}
+
+static struct symbolic_instance *instance_find(const char *name)
+{
+    struct symbolic_instance *inst;
+
+    list_for_each_entry(inst, &instances, list) {
+        if (strcmp(inst->name, name) == 0)
+            return inst;
+    }
+    return NULL;
+}
+
+// Created stopped, with a period of 1 second, on the first online CPU
+static ssize_t create_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    struct symbolic_instance *inst;
+    struct kernfs_node *kn;
+    int error;
+
+    inst = kzalloc(sizeof(*inst), GFP_KERNEL);
+    if (!inst)
+        return -ENOMEM;
+    error = instance_name_parse(buf, inst->name);
+    if (error) {
+        kfree(inst);
+        return error;
     }
+    atomic64_set(&inst->value, 0);
+    timerqueue_init(&inst->node);
+    inst->period_ns = NSEC_PER_SEC;
+    inst->cpu = cpumask_first(cpu_online_mask);
+
+    mutex_lock(&instances_lock);
+    // Also rejects the names of the attributes of the main counter
+    kn = sysfs_get_dirent(kobj->sd, inst->name);
+    if (kn) {
+        sysfs_put(kn);
+        mutex_unlock(&instances_lock);
+        kfree(inst);
+        return -EEXIST;
+    }
+    error = kobject_init_and_add(&inst->kobj, &instance_ktype, kobj, "%s", inst->name);
+    if (error) {
+        mutex_unlock(&instances_lock);
+        kobject_put(&inst->kobj);
+        return error;
+    }
+    list_add_tail(&inst->list, &instances);
+    mutex_unlock(&instances_lock);
     return count;
 }
 
-// Define the attributes for global_variable and timer_start_stop
-static struct kobj_attribute global_variable_attribute = __ATTR(global_variable, 0664, global_variable_show, global_variable_store);
-static struct kobj_attribute timer_start_stop_attribute = __ATTR(timer_start_stop, 0664, timer_start_stop_show, timer_start_stop_store);
+// Called with instances_lock held; the caller removes and drops the kobject
+// after unlocking, because removing its files waits for their stores, which
+// take instances_lock
+static void instance_unlink(struct symbolic_instance *inst)
+{
+    list_del(&inst->list);
+    if (inst->running)
+        instance_stop(inst);
+    inst->dead = true;
+}
+
+static ssize_t destroy_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    struct symbolic_instance *inst;
+    char name[INSTANCE_NAME_LEN];
+    int error = instance_name_parse(buf, name);
+
+    if (error)
+        return error;
+
+    mutex_lock(&instances_lock);
+    inst = instance_find(name);
+    if (inst)
+        instance_unlink(inst);
+    mutex_unlock(&instances_lock);
+    if (!inst)
+        return -ENOENT;
+    // Remove the directory now, so the name can be reused at once, even if
+    // someone still holds a reference to the kobject
+    kobject_del(&inst->kobj);
+    kobject_put(&inst->kobj);
+    return count;
+}
+
+static struct kobj_attribute create_attribute = __ATTR_WO(create);
+static struct kobj_attribute destroy_attribute = __ATTR_WO(destroy);
+
+static void timer_wheels_init(void)
+{
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        struct timer_wheel *wheel = per_cpu_ptr(&timer_wheels, cpu);
+
+        raw_spin_lock_init(&wheel->lock);
+        timerqueue_init_head(&wheel->queue);
+        hrtimer_init(&wheel->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS_PINNED_HARD);
+        wheel->timer.function = timer_wheel_callback;
+    }
+}
+
+// Destroys all instances and stops the wheels; the create attribute must be gone
+static void instances_destroy(void)
+{
+    struct symbolic_instance *inst, *tmp;
+    LIST_HEAD(dead);
+    int cpu;
+
+    mutex_lock(&instances_lock);
+    list_for_each_entry_safe(inst, tmp, &instances, list) {
+        instance_unlink(inst);
+        list_add(&inst->list, &dead);
+    }
+    mutex_unlock(&instances_lock);
+
+    list_for_each_entry_safe(inst, tmp, &dead, list) {
+        kobject_del(&inst->kobj);
+        kobject_put(&inst->kobj);
+    }
+    for_each_possible_cpu(cpu)
+        hrtimer_cancel(&per_cpu_ptr(&timer_wheels, cpu)->timer);
+}
 
 // Define the attribute array
 static struct attribute *attrs[] = {
     &global_variable_attribute.attr,
+    &global_variable_fast_attribute.attr,
     &timer_start_stop_attribute.attr,
+    &period_us_attribute.attr,
+    &overruns_attribute.attr,
+    &notify_every_attribute.attr,
+    &notify_threshold_attribute.attr,
+    &last_notify_attribute.attr,
+    &create_attribute.attr,
+    &destroy_attribute.attr,
     NULL,
 };
 
 // Define the attribute group
 static struct attribute_group attr_group = {
     .attrs = attrs,
+    .bin_attrs = bin_attrs,
+};
+
+// Tick instrumentation in /sys/kernel/symbolic_driver/tick_stats/
+static void tick_stats_snapshot(struct tick_stats *st)
+{
+    unsigned int seq;
+
+    do {
+        seq = read_seqbegin(&state_lock);
+        *st = tick_stats;
+    } while (read_seqretry(&state_lock, seq));
+}
+
+#define TICK_STATS_ATTR(_name, _expr)                                                           \
+static ssize_t tick_##_name##_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) \
+{                                                                                               \
+    struct tick_stats st;                                                                       \
+                                                                                                \
+    tick_stats_snapshot(&st);                                                                   \
+    return sprintf(buf, "%llu\n", (unsigned long long)(_expr));                                 \
+}                                                                                               \
+static struct kobj_attribute tick_##_name##_attribute = __ATTR(_name, 0444, tick_##_name##_show, NULL)
+
+TICK_STATS_ATTR(count, st.count);
+TICK_STATS_ATTR(lateness_avg_ns, st.count ? div64_u64(st.lateness_sum, st.count) : 0);
+TICK_STATS_ATTR(lateness_max_ns, st.lateness_max);
+TICK_STATS_ATTR(duration_avg_ns, st.count ? div64_u64(st.duration_sum, st.count) : 0);
+TICK_STATS_ATTR(duration_max_ns, st.duration_max);
+
+// One line per bucket up to the last non-empty one: "<from>-<to> ns: <count>"
+static ssize_t tick_lateness_hist_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    struct tick_stats st;
+    int i, last = 0, len = 0;
+
+    tick_stats_snapshot(&st);
+    for (i = 0; i < LATENESS_BUCKETS; i++) {
+        if (st.lateness_hist[i])
+            last = i;
+    }
+    for (i = 0; i <= last; i++) {
+        u64 from = i ? 1ULL << (i - 1) : 0;
+
+        if (i == LATENESS_BUCKETS - 1)
+            len += sysfs_emit_at(buf, len, "%llu+ ns: %llu\n", from, st.lateness_hist[i]);
+        else
+            len += sysfs_emit_at(buf, len, "%llu-%llu ns: %llu\n", from,
+                                 i ? (1ULL << i) - 1 : 0, st.lateness_hist[i]);
+    }
+    return len;
+}
+
+static ssize_t tick_reset_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    unsigned long flags;
+    bool reset;
+
+    if (kstrtobool(buf, &reset))
+        return -EINVAL;
+    if (reset) {
+        write_seqlock_irqsave(&state_lock, flags);
+        memset(&tick_stats, 0, sizeof(tick_stats));
+        write_sequnlock_irqrestore(&state_lock, flags);
+    }
+    return count;
+}
+
+static struct kobj_attribute tick_lateness_hist_attribute = __ATTR(lateness_hist, 0444, tick_lateness_hist_show, NULL);
+static struct kobj_attribute tick_reset_attribute = __ATTR(reset, 0200, NULL, tick_reset_store);
+
+static struct attribute *tick_stats_attrs[] = {
+    &tick_count_attribute.attr,
+    &tick_lateness_avg_ns_attribute.attr,
+    &tick_lateness_max_ns_attribute.attr,
+    &tick_lateness_hist_attribute.attr,
+    &tick_duration_avg_ns_attribute.attr,
+    &tick_duration_max_ns_attribute.attr,
+    &tick_reset_attribute.attr,
+    NULL,
+};
+
+static struct attribute_group tick_stats_group = {
+    .name = "tick_stats",
+    .attrs = tick_stats_attrs,
+};
+
+static const struct attribute_group *attr_groups[] = {
+    &attr_group,
+    &tick_stats_group,
+    NULL,
 };
 
 static int __init symbolic_driver_init(void)
@@ -81,23 +906,33 @@ static int __init symbolic_driver_init(void)
 
     printk(KERN_INFO "Symbolic Driver: Initializing\n");
 
+    error = percpu_counter_init(&global_percpu, 0, GFP_KERNEL);
+    if (error)
+        return error;
+
+    // Setup the timer before the attributes that start it appear
+    hrtimer_init(&my_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    my_timer.function = timer_callback;
+    timer_wheels_init();
+
     // Create a kobject under /sys/kernel/
     my_kobject = kobject_create_and_add("symbolic_driver", kernel_kobj);
     if (!my_kobject) {
         printk(KERN_ERR "Symbolic Driver: Failed to create kobject\n");
+        percpu_counter_destroy(&global_percpu);
         return -ENOMEM;
     }
 
     // Create the sysfs attributes
-    error = sysfs_create_group(my_kobject, &attr_group);
+    error = sysfs_create_groups(my_kobject, attr_groups);
     if (error) {
         printk(KERN_ERR "Symbolic Driver: Failed to create sysfs group\n");
         kobject_put(my_kobject);
+        percpu_counter_destroy(&global_percpu);
         return error;
     }
 
-    // Setup the timer
-    timer_setup(&my_timer, timer_callback, 0);
+    global_variable_kn = sysfs_get_dirent(my_kobject->sd, "global_variable");
 
     printk(KERN_INFO "Symbolic Driver: Initialization complete\n");
     return 0;
@@ -105,10 +940,13 @@ static int __init symbolic_driver_init(void)
 
 static void __exit symbolic_driver_exit(void)
 {
-    if (timer_running) {
-        del_timer(&my_timer);
-    }
+    // Remove the attributes first so that nothing restarts the timer
+    sysfs_remove_groups(my_kobject, attr_groups);
+    hrtimer_cancel(&my_timer);
+    instances_destroy();
+    sysfs_put(global_variable_kn);
     kobject_put(my_kobject);
+    percpu_counter_destroy(&global_percpu);
     printk(KERN_INFO "Symbolic Driver: Exiting\n");
 }
 
@@ -0,0 +1,64 @@
+#ifndef SYMBOLIC_DRIVER_H
+#define SYMBOLIC_DRIVER_H
+
+#include <linux/types.h>
+
+// Binary state file /sys/kernel/symbolic_driver/state. A read returns a
+// consistent snapshot of the whole driver state; new fields are only
+// appended, so readers check size. Fields are in host byte order.
+#define SYMBOLIC_STATE_VERSION 1
+
+#define SYMBOLIC_STATE_RUNNING 0x1      // Timer is running
+
+struct symbolic_driver_state {
+    __u32 version;              // SYMBOLIC_STATE_VERSION
+    __u32 size;                 // sizeof(struct symbolic_driver_state)
+    __s64 value;                // global_variable, exact
+    __u32 flags;                // SYMBOLIC_STATE_*
+    __u32 notify_every;
+    __u64 period_ns;
+    __u64 ticks;                // Timer callbacks since load
+    __u64 last_tick_ns;         // CLOCK_MONOTONIC time of the last tick
+    __u64 overruns;
+    __u64 notify_seq;
+    __u64 notify_ns;
+    __u64 notify_threshold;
+} __attribute__((packed));
+
+// A write of exactly this struct at offset 0 applies the fields selected
+// in mask at once. If any field is invalid, nothing is changed (-EINVAL).
+#define SYMBOLIC_SET_VALUE            0x01
+#define SYMBOLIC_SET_RUNNING          0x02
+#define SYMBOLIC_SET_PERIOD           0x04
+#define SYMBOLIC_SET_NOTIFY_EVERY     0x08
+#define SYMBOLIC_SET_NOTIFY_THRESHOLD 0x10
+#define SYMBOLIC_SET_ALL              0x1f
+
+struct symbolic_driver_update {
+    __u32 version;              // SYMBOLIC_STATE_VERSION
+    __u32 mask;                 // SYMBOLIC_SET_*
+    __s64 value;
+    __u64 period_ns;
+    __u32 running;              // 1 to start, 0 to stop
+    __u32 notify_every;
+    __u64 notify_threshold;
+} __attribute__((packed));
+
+#ifdef __KERNEL__
+
+// Counter behind /sys/kernel/symbolic_driver/global_variable, for other
+// modules. Safe from any context, including hard interrupts.
+void symbolic_driver_counter_add(s64 delta);
+
+// Exact read folds all CPUs together; the fast read does not and, with
+// percpu_mode=1, may be off by up to percpu_counter_batch per online CPU.
+s64 symbolic_driver_counter_read(bool exact);
+
+static inline void symbolic_driver_counter_inc(void)
+{
+    symbolic_driver_counter_add(1);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,59 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM symbolic_driver
+
+#if !defined(_SYMBOLIC_DRIVER_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _SYMBOLIC_DRIVER_TRACE_H
+
+#include <linux/tracepoint.h>
+
+// Tick events; disabled tracepoints cost next to nothing, so they replace
+// the per-tick printk. lateness_ns is the expiry time minus the deadline.
+TRACE_EVENT(symbolic_tick,
+    TP_PROTO(s64 value, u64 lateness_ns, u64 duration_ns, u64 missed),
+    TP_ARGS(value, lateness_ns, duration_ns, missed),
+
+    TP_STRUCT__entry(
+        __field(s64, value)
+        __field(u64, lateness_ns)
+        __field(u64, duration_ns)
+        __field(u64, missed)
+    ),
+
+    TP_fast_assign(
+        __entry->value = value;
+        __entry->lateness_ns = lateness_ns;
+        __entry->duration_ns = duration_ns;
+        __entry->missed = missed;
+    ),
+
+    TP_printk("value=%lld lateness_ns=%llu duration_ns=%llu missed=%llu",
+              __entry->value, __entry->lateness_ns, __entry->duration_ns, __entry->missed)
+);
+
+TRACE_EVENT(symbolic_instance_tick,
+    TP_PROTO(const char *name, s64 value, u64 lateness_ns),
+    TP_ARGS(name, value, lateness_ns),
+
+    TP_STRUCT__entry(
+        __array(char, name, 32)
+        __field(s64, value)
+        __field(u64, lateness_ns)
+    ),
+
+    TP_fast_assign(
+        strscpy(__entry->name, name, sizeof(__entry->name));
+        __entry->value = value;
+        __entry->lateness_ns = lateness_ns;
+    ),
+
+    TP_printk("name=%s value=%lld lateness_ns=%llu",
+              __entry->name, __entry->value, __entry->lateness_ns)
+);
+
+#endif
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE symbolic_driver_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "symbolic_driver.h"
+
+// Waits for change notifications on /sys/kernel/symbolic_driver/global_variable
+// in poll() and reports wakeup latency (from the notification in the driver
+// to the return from poll) and notifications missed between wakeups. After
+// a wakeup the value and the notification number come from one read of the
+// binary state file.
+//
+// Notification numbers and times are kept only for global_variable. For any
+// other attribute given with -f a wakeup is a POLLPRI with a changed value,
+// and only the number of wakeups is reported.
+
+#define SYSFS_DIR "/sys/kernel/symbolic_driver/"
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Reads a sysfs attribute from the start; sysfs regenerates it on each read
+static int read_attr(int fd, char *buf, size_t size) {
+    ssize_t n = pread(fd, buf, size - 1, 0);
+
+    if (n < 0)
+        return -1;
+    buf[n] = '\0';
+    return 0;
+}
+
+static int read_state(int fd, struct symbolic_driver_state *st) {
+    ssize_t n = pread(fd, st, sizeof(*st), 0);
+
+    if (n < (ssize_t)sizeof(*st) || st->version != SYMBOLIC_STATE_VERSION) {
+        fprintf(stderr, "unexpected state file\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char *argv[]) {
+    const char *attr = SYSFS_DIR "global_variable";
+    int duration = 0, verbose = 0, c;
+    char buf[64], prev[64];
+
+    while ((c = getopt(argc, argv, "f:d:v")) != -1) {
+        switch (c) {
+        case 'f': attr = optarg; break;
+        case 'd': duration = atoi(optarg); break;
+        case 'v': verbose = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-f attribute] [-d seconds] [-v]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const char *name = strrchr(attr, '/');
+    int by_seq = strcmp(name ? name + 1 : attr, "global_variable") == 0;
+    int fd = open(attr, O_RDONLY);
+    int state_fd = open(SYSFS_DIR "state", O_RDONLY);
+    if (fd < 0 || state_fd < 0) {
+        perror("open");
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    if (duration > 0) {
+        signal(SIGALRM, on_signal);
+        alarm(duration);
+    }
+
+    // The first read arms the notification
+    struct symbolic_driver_state st;
+    if (read_attr(fd, buf, sizeof(buf)) || read_state(state_fd, &st))
+        return 1;
+    uint64_t prev_seq = st.notify_seq;
+    strcpy(prev, buf);
+
+    size_t count = 0, cap = 1024;
+    uint64_t *lat = malloc(cap * sizeof(*lat)), missed = 0;
+    struct pollfd pfd = { .fd = fd, .events = POLLPRI | POLLERR };
+    if (!lat) {
+        perror("malloc");
+        return 1;
+    }
+
+    while (!stop) {
+        int ret = poll(&pfd, 1, -1);
+        uint64_t woke = now_ns();
+
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            return 1;
+        }
+        // Re-reading the attribute re-arms it for the next notification
+        if (read_attr(fd, buf, sizeof(buf)) || read_state(state_fd, &st))
+            return 1;
+        if (!by_seq) {
+            if (!(pfd.revents & (POLLPRI | POLLERR)) || !strcmp(buf, prev))
+                continue;
+            strcpy(prev, buf);
+            count++;
+            if (verbose)
+                printf("%s", buf);
+            continue;
+        }
+        if (st.notify_seq == prev_seq)
+            continue;   // No notification since the last read
+        missed += st.notify_seq - prev_seq - 1;
+        prev_seq = st.notify_seq;
+
+        if (count == cap) {
+            cap *= 2;
+            lat = realloc(lat, cap * sizeof(*lat));
+            if (!lat) {
+                perror("realloc");
+                return 1;
+            }
+        }
+        lat[count++] = woke > st.notify_ns ? woke - st.notify_ns : 0;
+        if (verbose)
+            printf("seq %llu value %lld\n", (unsigned long long)st.notify_seq, (long long)st.value);
+    }
+
+    if (!by_seq) {
+        printf("wakeups: %zu\n", count);
+        free(lat);
+        return 0;
+    }
+    printf("wakeups: %zu, missed notifications: %llu\n", count, (unsigned long long)missed);
+    if (count) {
+        uint64_t sum = 0;
+
+        qsort(lat, count, sizeof(*lat), cmp_u64);
+        for (size_t i = 0; i < count; i++)
+            sum += lat[i];
+        printf("wakeup latency, ns: min %llu, avg %llu, p50 %llu, p99 %llu, max %llu\n",
+               (unsigned long long)lat[0], (unsigned long long)(sum / count),
+               (unsigned long long)lat[count / 2], (unsigned long long)lat[count * 99 / 100],
+               (unsigned long long)lat[count - 1]);
+    }
+    free(lat);
+    return 0;
+}